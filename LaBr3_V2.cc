@@ -26,6 +26,10 @@
 #include "PrimaryGeneratorAction.hh"
 #include "DetectorConstruction.hh"
 #include "SteppingAction.hh"
+#include "StackingAction.hh"
+#include "TrackingAction.hh"
+#include "Checkpoint.hh"
+#include "SubEventPool.hh"
 #include "EventAction.hh"
 #include "PhysicsList.hh"
 #include "RunAction.hh"
@@ -72,12 +76,29 @@ int main(int argc,char** argv) {
   
   G4int evNumber(0); 
 
-  runManager->SetUserAction(new PrimaryGeneratorAction);
-  runManager->SetUserAction(new RunAction);
-  runManager->SetUserAction(new EventAction(&evNumber));
-  runManager->SetUserAction(new SteppingAction(&evNumber, seedAndTime));
-  
-  runManager->Initialize(); 
+  PrimaryGeneratorAction* primaryAction = new PrimaryGeneratorAction;
+  runManager->SetUserAction(primaryAction);
+  RunAction* runAction = new RunAction(seedAndTime);
+  EventAction* eventAction = new EventAction(&evNumber, runAction, seedAndTime);
+  runManager->SetUserAction(runAction);
+  runManager->SetUserAction(eventAction);
+  SteppingAction* steppingAction = new SteppingAction(&evNumber, seedAndTime, eventAction);
+  runManager->SetUserAction(steppingAction);
+  StackingAction* stackingAction = new StackingAction(eventAction);
+  runManager->SetUserAction(stackingAction);
+  eventAction->SetStackingAction(stackingAction);
+  runManager->SetUserAction(new TrackingAction);
+
+  Checkpoint* checkpoint = new Checkpoint(seedAndTime, eventAction, steppingAction, primaryAction);
+  eventAction->SetCheckpoint(checkpoint);
+
+  SubEventPool* subEventPool = new SubEventPool(steppingAction);
+  steppingAction->SetSubEventPool(subEventPool);
+  stackingAction->SetSubEventPool(subEventPool);
+  eventAction->SetSubEventPool(subEventPool);
+
+  // The kernel is initialised by /run/initialize in the macros, so that
+  // PreInit commands (e.g. /LaBr/phys/...) can be given before it.
   G4UImanager* UImanager = G4UImanager::GetUIpointer();
   G4VisManager* visManager = nullptr;
    
@@ -94,6 +115,8 @@ int main(int argc,char** argv) {
   }
  
   delete visManager;
+  delete checkpoint;
+  delete subEventPool;
   delete runManager;
 
   return 0;
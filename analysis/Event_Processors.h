@@ -0,0 +1,285 @@
+#ifndef Event_Processors_h
+#define Event_Processors_h
+
+#include "Histo_Collection.h"
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TH2.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+// CopyNo of tree T is module*1000 + channel (/LaBr/array/ in the simulation);
+// positions are in the frame of that module
+inline Int_t ModuleOf(Int_t copyNo) { return copyNo/1000; }
+inline Int_t ChannelOf(Int_t copyNo) { return copyNo%1000; }
+
+// All rows of one event of tree T, one vector per branch. Only the
+// branches some processor asks for are read, the other vectors stay empty.
+struct EventRows
+{
+  Int_t evNr = -1;
+  std::vector<Int_t> pType, pName, Det, CopyNo;
+  std::vector<Double_t> KE, Edep, posX, posY, posZ, time, momX, momY, momZ;
+
+  std::size_t Size() const { return Det.size(); }
+
+  void Clear()
+  {
+    evNr = -1;
+    for (auto* v : {&pType, &pName, &Det, &CopyNo}) v->clear();
+    for (auto* v : {&KE, &Edep, &posX, &posY, &posZ, &time, &momX, &momY, &momZ}) v->clear();
+  }
+};
+
+// One study run on every event. Processors are created by name in
+// AnalysisPipeline::Configure and write their histograms into the output.
+class EventProcessor
+{
+public:
+  virtual ~EventProcessor() {;};
+  virtual void Process(const EventRows& event) = 0;
+  virtual void Write() = 0;
+  // Branches of T read for this study (evNr and Det are always read)
+  virtual std::vector<std::string> Branches() const = 0;
+  // Uses the LaBr3 deposit rows (Det 11, /LaBr/output/edepSteps)
+  virtual bool NeedsEdepRows() const { return false; }
+};
+
+// Hit positions and SiPM hits against the depth of the gamma interaction
+class PositionMapProcessor : public EventProcessor
+{
+public:
+  PositionMapProcessor(double minMaxDim, double binSize) { hist.CreatePositionHistos(minMaxDim, binSize); }
+
+  void Process(const EventRows& event)
+  {
+    // Depth of the gamma interaction in each module
+    std::map<Int_t, Double_t> gammaZ;
+    for (std::size_t i=0; i<event.Size(); i++) {
+      Int_t module = ModuleOf(event.CopyNo[i]);
+      if (event.pType[i] == 0) gammaZ[module] = event.posZ[i];
+      hist.FillPositionHisto(TVector3(event.posX[i], event.posY[i], event.posZ[i]), HistoLabel::cAll);
+      if (event.Det[i] == 22) {
+        auto z = gammaZ.find(module);
+        hist.FillPositionHisto(TVector3(event.posX[i], event.posY[i], z != gammaZ.end() ? z->second : -35), HistoLabel::cGZH_XY);
+      }
+    }
+  }
+
+  void Write() { hist.WriteHistos(); }
+  std::vector<std::string> Branches() const { return {"pType", "CopyNo", "postPosX", "postPosY", "postPosZ"}; }
+  bool NeedsEdepRows() const { return true; }
+
+private:
+  HistCollection hist;
+};
+
+// Photons per event, per SiPM channel and the LaBr3 deposit (Det 11 rows,
+// /LaBr/output/edepSteps)
+class SpectrumProcessor : public EventProcessor
+{
+public:
+  SpectrumProcessor()
+  {
+    PhotonsPerEvent = new TH1D("PhotonsPerEvent", "Detected photons per event; photons; events", 5000, 0, 5000);
+    SiPMChannel = new TH1D("SiPMChannel", "Detected photons per SiPM; channel; photons", 52, -0.5, 51.5);
+    EdepLaBr3 = new TH1D("EdepLaBr3", "Energy deposit in LaBr3; E [MeV]; events", 2000, 0, 2);
+  }
+
+  void Process(const EventRows& event)
+  {
+    Int_t nPhotons = 0;
+    Double_t edep = 0;
+    for (std::size_t i=0; i<event.Size(); i++) {
+      if (event.Det[i] == 22) {
+        nPhotons++;
+        SiPMChannel->Fill(ChannelOf(event.CopyNo[i]));
+      } else if (event.Det[i] == 11) {
+        edep += event.Edep[i];
+      }
+    }
+    if (nPhotons > 0) PhotonsPerEvent->Fill(nPhotons);
+    if (edep > 0) EdepLaBr3->Fill(edep);
+  }
+
+  void Write()
+  {
+    PhotonsPerEvent->Write();
+    SiPMChannel->Write();
+    EdepLaBr3->Write();
+  }
+
+  std::vector<std::string> Branches() const { return {"CopyNo", "Edep"}; }
+  bool NeedsEdepRows() const { return true; }
+
+private:
+  TH1D* PhotonsPerEvent;
+  TH1D* SiPMChannel;
+  TH1D* EdepLaBr3;
+};
+
+// Arrival times of the SiPM photons
+class TimingProcessor : public EventProcessor
+{
+public:
+  TimingProcessor()
+  {
+    PhotonTime = new TH1D("PhotonTime", "Photon arrival time; t [ns]; photons", 1000, 0, 200);
+    FirstPhotonTime = new TH1D("FirstPhotonTime", "First photon of the event; t [ns]; events", 1000, 0, 20);
+  }
+
+  void Process(const EventRows& event)
+  {
+    Double_t first = -1;
+    for (std::size_t i=0; i<event.Size(); i++) {
+      if (event.Det[i] != 22) continue;
+      PhotonTime->Fill(event.time[i]);
+      if (first < 0 || event.time[i] < first) first = event.time[i];
+    }
+    if (first >= 0) FirstPhotonTime->Fill(first);
+  }
+
+  void Write()
+  {
+    PhotonTime->Write();
+    FirstPhotonTime->Write();
+  }
+
+  std::vector<std::string> Branches() const { return {"Gtime"}; }
+
+private:
+  TH1D* PhotonTime;
+  TH1D* FirstPhotonTime;
+};
+
+// Number of SiPMs and BGO bars that saw light
+class MultiplicityProcessor : public EventProcessor
+{
+public:
+  MultiplicityProcessor()
+  {
+    SiPMMultiplicity = new TH1D("SiPMMultiplicity", "SiPMs hit per event; SiPMs; events", 53, -0.5, 52.5);
+    BGOMultiplicity = new TH1D("BGOMultiplicity", "BGO bars with light per event; bars; events", 29, -0.5, 28.5);
+  }
+
+  void Process(const EventRows& event)
+  {
+    std::set<Int_t> sipms, bars;
+    for (std::size_t i=0; i<event.Size(); i++) {
+      if (event.Det[i] == 22) sipms.insert(event.CopyNo[i]);
+      if (event.Det[i] == 23) bars.insert(event.CopyNo[i]);
+    }
+    SiPMMultiplicity->Fill(sipms.size());
+    BGOMultiplicity->Fill(bars.size());
+  }
+
+  void Write()
+  {
+    SiPMMultiplicity->Write();
+    BGOMultiplicity->Write();
+  }
+
+  std::vector<std::string> Branches() const { return {"CopyNo"}; }
+
+private:
+  TH1D* SiPMMultiplicity;
+  TH1D* BGOMultiplicity;
+};
+
+// Light-weighted centroid of the SiPM hits (Anger logic), one per module hit
+class CentroidProcessor : public EventProcessor
+{
+public:
+  CentroidProcessor()
+  {
+    Centroid = new TH2D("CentroidXY", "Light centroid; X [mm]; Y [mm]", 300, -30, 30, 300, -30, 30);
+  }
+
+  void Process(const EventRows& event)
+  {
+    struct Sum { Double_t x = 0, y = 0; Int_t n = 0; };
+    std::map<Int_t, Sum> sums;
+    for (std::size_t i=0; i<event.Size(); i++) {
+      if (event.Det[i] != 22) continue;
+      Sum& sum = sums[ModuleOf(event.CopyNo[i])];
+      sum.x += event.posX[i];
+      sum.y += event.posY[i];
+      sum.n++;
+    }
+    for (const auto& module : sums) Centroid->Fill(module.second.x/module.second.n, module.second.y/module.second.n);
+  }
+
+  void Write() { Centroid->Write(); }
+  std::vector<std::string> Branches() const { return {"CopyNo", "postPosX", "postPosY"}; }
+
+private:
+  TH2D* Centroid;
+};
+
+class AnalysisPipeline
+{
+public:
+  ~AnalysisPipeline() { for (auto* p : processors) delete p; }
+
+  // Comma separated list of: positions, spectra, timing, multiplicity, centroid
+  bool Configure(const std::string& list)
+  {
+    std::istringstream names(list);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+      if (name == "positions") {
+        processors.push_back(new PositionMapProcessor(30, 1)); // in mm
+      } else if (name == "spectra") {
+        processors.push_back(new SpectrumProcessor());
+      } else if (name == "timing") {
+        processors.push_back(new TimingProcessor());
+      } else if (name == "multiplicity") {
+        processors.push_back(new MultiplicityProcessor());
+      } else if (name == "centroid") {
+        processors.push_back(new CentroidProcessor());
+      } else {
+        std::cout << "Unknown processor " << name << std::endl;
+        return false;
+      }
+      std::cout << "Processor added: " << name << std::endl;
+    }
+    return true;
+  }
+
+  void Process(const EventRows& event) { for (auto* p : processors) p->Process(event); }
+
+  bool NeedsEdepRows() const
+  {
+    for (auto* p : processors) if (p->NeedsEdepRows()) return true;
+    return false;
+  }
+
+  std::set<std::string> Branches() const
+  {
+    std::set<std::string> branches = {"evNr", "Det"};
+    for (auto* p : processors) {
+      for (const std::string& b : p->Branches()) branches.insert(b);
+    }
+    return branches;
+  }
+
+  void SaveHistos(TString output)
+  {
+    std::cout << "Saving histos to " << output << std::endl;
+    TFile* outfile = new TFile(output, "RECREATE");
+    outfile->cd();
+    for (auto* p : processors) p->Write();
+    outfile->Close();
+  }
+
+private:
+  std::vector<EventProcessor*> processors;
+};
+
+#endif
@@ -12,6 +12,7 @@
 #include "TH1.h"
 #include "TH2.h"
 #include "TH3.h"
+#include "THnSparse.h"
 
 enum HistoLabel {
   cAll, cGZH_XY
@@ -23,26 +24,67 @@ public:
   HistCollection() {;};
   ~HistCollection() {;};
 
+  // Position maps are sparse: only voxels that were hit take memory, so the
+  // bin size can go far below 1 mm without the cost of a dense TH3D.
   void CreatePositionHistos(double minMaxDim, double binSize)
   {
-    PositionsAll = new TH3D("PositionsAll","Positions; X [mm]; Y [mm]; Z [mm]", 2*minMaxDim/binSize, -minMaxDim-0.5*binSize, minMaxDim-0.5*binSize,
-                            2*minMaxDim/binSize, -minMaxDim-0.5*binSize, minMaxDim-0.5*binSize,
-                            2*minMaxDim/binSize, -minMaxDim-0.5*binSize, minMaxDim-0.5*binSize);
-    PositionsGammaZDetXY = new TH3D("PositionsGammaZDetXY","Positions; X of hit [mm]; Y of hit [mm]; Z of gamma [mm]",
-                                    2*minMaxDim/binSize, -minMaxDim-0.5*binSize, minMaxDim-0.5*binSize,
-                                    2*minMaxDim/binSize, -minMaxDim-0.5*binSize, minMaxDim-0.5*binSize,
-                                    2*minMaxDim/binSize, -minMaxDim-0.5*binSize, minMaxDim-0.5*binSize);
+    Int_t nBins = 2*minMaxDim/binSize;
+    Int_t bins[3] = {nBins, nBins, nBins};
+    Double_t min[3] = {-minMaxDim-0.5*binSize, -minMaxDim-0.5*binSize, -minMaxDim-0.5*binSize};
+    Double_t max[3] = {minMaxDim-0.5*binSize, minMaxDim-0.5*binSize, minMaxDim-0.5*binSize};
+
+    PositionsAll = new THnSparseD("PositionsAll", "Positions", 3, bins, min, max);
+    PositionsAll->GetAxis(0)->SetTitle("X [mm]");
+    PositionsAll->GetAxis(1)->SetTitle("Y [mm]");
+    PositionsAll->GetAxis(2)->SetTitle("Z [mm]");
+    PositionsGammaZDetXY = new THnSparseD("PositionsGammaZDetXY", "Positions", 3, bins, min, max);
+    PositionsGammaZDetXY->GetAxis(0)->SetTitle("X of hit [mm]");
+    PositionsGammaZDetXY->GetAxis(1)->SetTitle("Y of hit [mm]");
+    PositionsGammaZDetXY->GetAxis(2)->SetTitle("Z of gamma [mm]");
   }
 
   void FillPositionHisto(TVector3 vector, HistoLabel label) {
+    Double_t x[3] = {vector.X(), vector.Y(), vector.Z()};
+    GetPositionHisto(label)->Fill(x);
+  }
+
+  THnSparse* GetPositionHisto(HistoLabel label) const {
     switch (label) {
       case HistoLabel::cAll:
-        PositionsAll->Fill(vector.X(), vector.Y(), vector.Z());
-        break;
+        return PositionsAll;
       case HistoLabel::cGZH_XY:
-        PositionsGammaZDetXY->Fill(vector.X(), vector.Y(), vector.Z());
-        break;
+        return PositionsGammaZDetXY;
     }
+    return nullptr;
+  }
+
+  // Adds the maps of another collection with the same binning, e.g. one
+  // filled by another thread or from another file.
+  void Merge(const HistCollection& other)
+  {
+    PositionsAll->Add(other.PositionsAll);
+    PositionsGammaZDetXY->Add(other.PositionsGammaZDetXY);
+  }
+
+  // Axes: 0 = X, 1 = Y, 2 = Z; the caller owns the returned histogram
+  TH1D* Project1D(HistoLabel label, Int_t axis) const {
+    return GetPositionHisto(label)->Projection(axis);
+  }
+
+  TH2D* Project2D(HistoLabel label, Int_t xAxis, Int_t yAxis) const {
+    return GetPositionHisto(label)->Projection(yAxis, xAxis);
+  }
+
+  // Writes into the current directory; the caller owns the file
+  void WriteHistos()
+  {
+    PositionsAll->Write("PositionsAll");
+    PositionsGammaZDetXY->Write("PositionsGammaZDetXY");
+    Project2D(HistoLabel::cAll, 0, 1)->Write("PositionsAll_XY");
+    Project2D(HistoLabel::cAll, 0, 2)->Write("PositionsAll_XZ");
+    Project2D(HistoLabel::cGZH_XY, 0, 1)->Write("PositionsGammaZDetXY_XY");
+    Project1D(HistoLabel::cGZH_XY, 2)->Write("PositionsGammaZDetXY_Z");
+    std::cout << "Filled voxels: " << PositionsAll->GetNbins() << " and " << PositionsGammaZDetXY->GetNbins() << std::endl;
   }
 
   void SaveHistos(TString output)
@@ -50,14 +92,13 @@ public:
     std::cout << "Saving histos to " << output << std::endl;
     TFile* outfile = new TFile(output, "RECREATE");
     outfile->cd();
-    PositionsAll->Write("PositionsAll");
-    PositionsGammaZDetXY->Write("PositionsGammaZDetXY");
+    WriteHistos();
     outfile->Close();
   }
 
 private:
-  TH3D* PositionsAll;
-  TH3D* PositionsGammaZDetXY;
+  THnSparseD* PositionsAll;
+  THnSparseD* PositionsGammaZDetXY;
 };
 
 #endif
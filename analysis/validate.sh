@@ -0,0 +1,33 @@
+#!/bin/bash
+# Runs a reference and an accelerated macro of LaBr3_V2 with the same seeds
+# and compares them with CompareRuns.exe:
+#   ./validate.sh <LaBr3_V2 binary> reference.mac test.mac [seed1 seed2] [-- CompareRuns options]
+# The result goes to validation.json; the exit code is 0 on pass, 2 on fail.
+
+if [ $# -lt 3 ]; then
+  echo "Usage: $0 <LaBr3_V2 binary> reference.mac test.mac [seed1 seed2] [-- CompareRuns options]"
+  exit 1
+fi
+
+exe=$1; ref=$2; test=$3; shift 3
+seed1=12345; seed2=67890
+if [ $# -ge 2 ] && [ "$1" != "--" ]; then seed1=$1; seed2=$2; shift 2; fi
+[ "$1" == "--" ] && shift
+
+here=$(cd "$(dirname "$0")" && pwd)
+
+run() {
+  local macro=$1 tag=$2
+  local seeded=validate_$tag.mac
+  echo "/random/setSeeds $seed1 $seed2" > $seeded
+  echo "/control/execute $macro" >> $seeded
+  $exe $seeded > validate_$tag.log 2>&1 || { echo "$tag run failed, see validate_$tag.log"; exit 1; }
+  # The job tags its files with time and seed; take the newest ones
+  mv "$(ls -t Histos_*.root | head -1)" Histos_$tag.root
+  mv "$(ls -t Output_*.root | head -1)" Output_$tag.root
+}
+
+run $ref ref
+run $test test
+
+$here/CompareRuns.exe --json validation.json "$@" Histos_ref.root Output_ref.root Histos_test.root Output_test.root
@@ -0,0 +1,42 @@
+#ifndef BGOVeto_h
+#define BGOVeto_h 1
+
+#include "globals.hh"
+
+class G4GenericMessenger;
+
+// Anti-Compton veto of the BGO ring (/LaBr/veto/). BGO SiPM photons that
+// arrive inside the time window are summed; once they reach the threshold
+// the event is vetoed and the optical photons in the BGO are no longer
+// tracked. Vetoed events are either tagged (Vetoed in tree E, left out of
+// the suppressed spectrum) or dropped by aborting them.
+class BGOVeto
+{
+public:
+  BGOVeto();
+  ~BGOVeto();
+
+  G4bool IsActive() const {return threshold > 0;}
+  G4bool IsVetoed() const {return vetoed;}
+  G4bool DropsEvents() const {return mode == "drop";}
+
+  void Clear() {nPhotons = 0; vetoed = false;}
+  G4bool AddPhoton(G4double time);
+  void EndOfEvent();
+  void PrintStatistics() const;
+
+private:
+  G4GenericMessenger* messenger;
+
+  G4int threshold;
+  G4double windowStart;
+  G4double windowEnd;
+  G4String mode;
+
+  G4int nPhotons;
+  G4bool vetoed;
+  G4long nEvents;
+  G4long nVetoed;
+};
+
+#endif
@@ -30,7 +30,13 @@
 #include "G4VPhysicsConstructor.hh"
 
 class G4Radioactivation;
+class G4GenericMessenger;
 
+// Radioactive decay with the variance reduction of G4Radioactivation:
+// nucleus splitting, branching-ratio biasing, nuclide limits and
+// time-window (decay bias / source time profile) biasing. Biased decays
+// give their products a statistical weight, so outputs must be filled
+// with the track weight.
 class BiasedRDPhysics : public G4VPhysicsConstructor
 {
 public:
@@ -41,7 +47,26 @@ public:
 // This is a dummy method for physics
   virtual void ConstructParticle();
   virtual void ConstructProcess();
+
+  void SetSplitNuclei(G4int n);
+  void SetBRBias(G4bool val);
+  void SetDecayBias(G4String fileName);
+  void SetSourceTimeProfile(G4String fileName);
+  void SelectVolume(G4String volumeName);
+  void ApplyNucleusLimits();
+
+private:
+  void DefineCommands();
+
+  G4Radioactivation* radioactivation;
+  G4GenericMessenger* messenger;
+
+  G4int splitNuclei;
+  G4bool brBias;
+  G4String decayBiasFile;
+  G4String sourceTimeFile;
+  G4String volumeName;
+  G4int aMin, aMax, zMin, zMax;
 };
 
 #endif
-
@@ -0,0 +1,42 @@
+#ifndef Checkpoint_h
+#define Checkpoint_h 1
+
+#include "globals.hh"
+
+class G4GenericMessenger;
+class EventAction;
+class SteppingAction;
+class PrimaryGeneratorAction;
+
+// Periodic checkpoints at event boundaries for long runs. Every N events
+// the output trees are auto-saved, the histograms written, and the RNG
+// engine state, the last completed event and, in list mode, the next
+// record of the primary list recorded in <file>.state.
+// /LaBr/checkpoint/resume <file>.state restores the engine and continues
+// the event numbering; when the trees on disk still match the checkpoint
+// the new events are appended to them, otherwise they go to this job's
+// files (histograms always do, merge them with hadd).
+class Checkpoint
+{
+public:
+  Checkpoint(G4String nameAdd, EventAction* evAction, SteppingAction* stAction, PrimaryGeneratorAction* primAction);
+  ~Checkpoint();
+
+  void EndOfEvent(G4int eventNr);
+  void Save(G4int eventNr);
+  void Resume(G4String stateFile);
+
+private:
+  G4GenericMessenger* messenger;
+  EventAction* eventAction;
+  SteppingAction* steppingAction;
+  PrimaryGeneratorAction* primaryAction;
+
+  G4String fileName;
+  G4int saveEvery;
+  G4int eventsSinceSave;
+  G4bool sameFile;
+  G4int nSaved;
+};
+
+#endif
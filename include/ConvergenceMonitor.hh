@@ -0,0 +1,59 @@
+
+#ifndef ConvergenceMonitor_h
+#define ConvergenceMonitor_h 1
+
+#include "globals.hh"
+
+#include <cfloat>
+#include <cmath>
+
+class G4GenericMessenger;
+
+// Watches per-event results during a run and aborts the run once every
+// enabled target has reached its relative precision:
+//  - centroid of the photopeak light output (photons of events whose LaBr3
+//    deposit falls in the peak window),
+//  - photopeak resolution (FWHM/centroid) of the same events,
+//  - mean number of detected photons per SiPM.
+class ConvergenceMonitor
+{
+public:
+  ConvergenceMonitor();
+  ~ConvergenceMonitor();
+
+  void Reset();
+  void AddEvent(G4double edepLaBr3, G4int nPhotons);
+  void Report() const;
+
+private:
+  struct RunningStat {
+    G4long n = 0;
+    G4double mean = 0.;
+    G4double m2 = 0.;
+
+    void Add(G4double x);
+    G4double Variance() const {return n > 1 ? m2/(n - 1) : 0.;}
+    G4double ErrorOfMean() const {return n > 1 ? std::sqrt(Variance()/n) : DBL_MAX;}
+  };
+
+  G4bool Converged(G4bool print) const;
+  G4double CentroidPrecision() const;
+  G4double ResolutionPrecision() const;
+  G4double PhotonPrecision() const;
+
+  G4GenericMessenger* messenger;
+
+  RunningStat peak;
+  RunningStat photonsPerSiPM;
+  G4long nEvents;
+
+  G4double peakMin;
+  G4double peakMax;
+  G4double centroidTarget;
+  G4double resolutionTarget;
+  G4double photonTarget;
+  G4int checkInterval;
+  G4int minEvents;
+};
+
+#endif
@@ -3,9 +3,26 @@
 #define DetectorConstruction_h 1
 
 #include "G4VUserDetectorConstruction.hh"
+#include "G4Transform3D.hh"
+#include "globals.hh"
+
+#include <vector>
 
 class G4VPhysicalVolume;
+class G4GenericMessenger;
+class OpticalPropertyRegistry;
 
+// One module is the LaBr3 detector with its SiPM plane and BGO ring in a
+// vacuum envelope; /LaBr/array/ places it nModules times, as a planar grid
+// or as a ring with the crystal faces towards the centre. The envelope
+// copy number is the module number, so a touchable decodes as (module,
+// channel) and the output uses module*kModuleStride + channel.
+// Positions in the output (T rows, exported truth) are in the frame of
+// their module, so per-module maps line up whatever the layout.
+// The optical grease between the window and the SiPMs is either a thin
+// optgel volume or, with /LaBr/coupling/model coated, a thin-film surface
+// on the window-SiPM boundary (Geant4 >= 11.1); its absorption is then
+// applied by SteppingAction over GetCouplingThickness().
 class DetectorConstruction : public G4VUserDetectorConstruction
 {
 public:
@@ -13,8 +30,27 @@ public:
   ~DetectorConstruction();
 
   G4VPhysicalVolume* Construct();
-  
+
+  static const G4int kModuleStride = 1000;
+
+  G4double GetCouplingThickness() const {return CouplingModel == "coated" ? CouplingThickness : 0.;}
+
 private:
+  std::vector<G4Transform3D> ModuleTransforms(G4double moduleR, G4double moduleHalfZ, G4double& extent) const;
+
+  OpticalPropertyRegistry* opticalProperties;
+  G4GenericMessenger* messenger;
+  G4GenericMessenger* couplingMessenger;
+
+  G4String Layout;
+  G4int NModules;
+  G4int Columns;
+  G4double Pitch;
+  G4double RingRadius;
+
+  G4String CouplingModel;
+  G4double CouplingThickness;
+
   G4double WorldSize;
   G4double LaBr3Rmin;
   G4double LaBr3Rmax;
@@ -2,6 +2,7 @@
 #define EventAction_h 1
 
 #include "G4UserEventAction.hh"
+#include "G4ThreeVector.hh"
 #include "globals.hh"
 
 #include "TProfile.h"
@@ -12,74 +13,101 @@
 
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 using namespace std;
 
+class RunAction;
+class G4GenericMessenger;
+class EventExporter;
+class Checkpoint;
+class PhotonTiming;
+class BGOVeto;
+class SubEventPool;
+class StackingAction;
+
 class EventAction : public G4UserEventAction
 {
 public:
-  EventAction(G4int* evN);
+  EventAction(G4int* evN, RunAction* runAct, G4String nameAdd);
   ~EventAction();
 
   void BeginOfEventAction(const G4Event*);
   void EndOfEventAction(const G4Event*);
-  void addEdepTotal0(G4double Edep) {TotalEnergyDeposit[0]+= Edep;};
-  void addEdepTotal1(G4double Edep) {TotalEnergyDeposit[1]+= Edep;};
-  void addEdepTotal2(G4double Edep) {TotalEnergyDeposit[2]+= Edep;};
-  void addEdepTotal3(G4double Edep) {TotalEnergyDeposit[3]+= Edep;};
-  void addEdepTotal4(G4double Edep) {TotalEnergyDeposit[4]+= Edep;};
-  void addEdepTotal5(G4double Edep) {TotalEnergyDeposit[5]+= Edep;};
-  void addEdepTotal6(G4double Edep) {TotalEnergyDeposit[6]+= Edep;};
-  void addEdepTotal7(G4double Edep) {TotalEnergyDeposit[7]+= Edep;};
-  void addEdepTotal8(G4double Edep) {TotalEnergyDeposit[8]+= Edep;};
-  void addEdepTotal9(G4double Edep) {TotalEnergyDeposit[9]+= Edep;};
-  void addEdepTotal10(G4double Edep) {TotalEnergyDeposit[10]+= Edep;};
-  void addEdepTotal11(G4double Edep) {TotalEnergyDeposit[11]+= Edep;};
-  void addEdepTotal12(G4double Edep) {TotalEnergyDeposit[12]+= Edep;};
-  void addEdepTotal13(G4double Edep) {TotalEnergyDeposit[13]+= Edep;};
-  void addEdepTotal14(G4double Edep) {TotalEnergyDeposit[14]+= Edep;};
-  void addEdepTotal15(G4double Edep) {TotalEnergyDeposit[15]+= Edep;};
-  void addEdepTotal16(G4double Edep) {TotalEnergyDeposit[16]+= Edep;};
-  void addEdepTotal17(G4double Edep) {TotalEnergyDeposit[17]+= Edep;};
-  void addEdepTotal18(G4double Edep) {TotalEnergyDeposit[18]+= Edep;};
-  void addEdepTotal19(G4double Edep) {TotalEnergyDeposit[19]+= Edep;};
-  void addEdepTotal20(G4double Edep) {TotalEnergyDeposit[20]+= Edep;};
-  void addEdepTotal21(G4double Edep) {TotalEnergyDeposit[21]+= Edep;};
-  void addEdepTotal22(G4double Edep) {TotalEnergyDeposit[22]+= Edep;};
-  void addEdepTotal23(G4double Edep) {TotalEnergyDeposit[23]+= Edep;};
+
+  static const G4int kNSiPM = 52;
+  static const G4int kNBGO = 28;
+  // Energy deposit slots: the LaBr3 crystal, the BGO bars (kSlotBGO + copy
+  // number), the PTFE reflector and the aluminium housing
+  static const G4int kSlotLaBr3 = 0;
+  static const G4int kSlotBGO = 1;
+  static const G4int kSlotReflector = kSlotBGO + kNBGO;
+  static const G4int kSlotHousing = kSlotReflector + 1;
+  static const G4int kNEdepSlots = kSlotHousing + 1;
+
+  void AddEdep(G4int slot, G4double edep, G4double visible, G4double weight);
+  void AddSiPMPhoton(G4int channel, G4double time);
+  void AddBGOPhoton(G4int bar, G4double time);
+  void AddDecay(G4double q, G4double time, G4double weight);
+  void AddYield(G4int slot, G4int nPhotons) {Yield[slot] += nPhotons;}
+  G4double GetEdep(G4int slot) const {return Edep[slot];}
+  G4bool IsVetoed() const;
+  void SetTreeBufferBytes(Long64_t bytes) {treeBufferBytes = bytes;}
+  void AddLaBr3Position(const G4ThreeVector& pos, G4double edep) {EdepPosition += edep*pos;}
+
+  void SetUniformEfficiency(G4double eff);
+  void SetEfficiencyFile(G4String fileName);
 
   TTree* GetListMode() {return ListMode;}
-  void SetBranchListMode() {
-    ListMode->Branch("TotalEnergyDeposit1", &TotalEnergyDeposit[0], "TotalEnergyDeposit0/D");
-    ListMode->Branch("TotalEnergyDeposit2", &TotalEnergyDeposit[1], "TotalEnergyDeposit1/D");
-    ListMode->Branch("TotalEnergyDeposit3", &TotalEnergyDeposit[2], "TotalEnergyDeposit2/D");
-    ListMode->Branch("TotalEnergyDeposit4", &TotalEnergyDeposit[3], "TotalEnergyDeposit3/D");
-    ListMode->Branch("TotalEnergyDeposit5", &TotalEnergyDeposit[4], "TotalEnergyDeposit4/D");
-    ListMode->Branch("TotalEnergyDeposit6", &TotalEnergyDeposit[5], "TotalEnergyDeposit5/D");
-    ListMode->Branch("TotalEnergyDeposit7", &TotalEnergyDeposit[6], "TotalEnergyDeposit6/D");
-    ListMode->Branch("TotalEnergyDeposit8", &TotalEnergyDeposit[7], "TotalEnergyDeposit7/D");
-    ListMode->Branch("TotalEnergyDeposit9", &TotalEnergyDeposit[8], "TotalEnergyDeposit8/D");
-    ListMode->Branch("TotalEnergyDeposit10",&TotalEnergyDeposit[9], "TotalEnergyDeposit9/D");
-    ListMode->Branch("TotalEnergyDeposit11",&TotalEnergyDeposit[10],"TotalEnergyDeposit10/D");
-    ListMode->Branch("TotalEnergyDeposit12",&TotalEnergyDeposit[11],"TotalEnergyDeposit11/D");
-    ListMode->Branch("TotalEnergyDeposit13",&TotalEnergyDeposit[12],"TotalEnergyDeposit12/D");
-    ListMode->Branch("TotalEnergyDeposit14",&TotalEnergyDeposit[13],"TotalEnergyDeposit13/D");
-    ListMode->Branch("TotalEnergyDeposit15",&TotalEnergyDeposit[14],"TotalEnergyDeposit14/D");
-    ListMode->Branch("TotalEnergyDeposit16",&TotalEnergyDeposit[15],"TotalEnergyDeposit15/D");
-    ListMode->Branch("TotalEnergyDeposit17",&TotalEnergyDeposit[16],"TotalEnergyDeposit16/D");
-    ListMode->Branch("TotalEnergyDeposit18",&TotalEnergyDeposit[17],"TotalEnergyDeposit17/D");
-    ListMode->Branch("TotalEnergyDeposit19",&TotalEnergyDeposit[18],"TotalEnergyDeposit18/D");
-    ListMode->Branch("TotalEnergyDeposit20",&TotalEnergyDeposit[19],"TotalEnergyDeposit19/D");
-    ListMode->Branch("TotalEnergyDeposit21",&TotalEnergyDeposit[20],"TotalEnergyDeposit20/D");
-    ListMode->Branch("TotalEnergyDeposit22",&TotalEnergyDeposit[21],"TotalEnergyDeposit21/D");
-    ListMode->Branch("TotalEnergyDeposit23",&TotalEnergyDeposit[22],"TotalEnergyDeposit22/D");
-    ListMode->Branch("TotalEnergyDeposit24",&TotalEnergyDeposit[23],"TotalEnergyDeposit23/D");
-  } 
-   
+  void SetBranchListMode();
+
+  void SetCheckpoint(Checkpoint* val) {checkpoint = val;}
+  void SetSubEventPool(SubEventPool* val) {subEventPool = val;}
+  void SetStackingAction(StackingAction* val) {stackingAction = val;}
+  void SetEventOffset(G4int offset) {eventOffset = offset;}
+  const G4String& GetOutputFileName() const {return fileOutName;}
+  Long64_t SaveCheckpoint();
+  G4bool ResumeOutput(const G4String& fileName, Long64_t entries);
+
 private:
+  void FillEvent();
+  void AttachBranches(G4bool create);
+
   G4int PrintModulo;
+  Long64_t treeBufferBytes;
   G4int *evNr;
-  G4double TotalEnergyDeposit[24];
+  RunAction* runAction;
+  G4GenericMessenger* messenger;
+  G4GenericMessenger* yieldMessenger;
+  EventExporter* exporter;
+  PhotonTiming* timing;
+  BGOVeto* veto;
+  Checkpoint* checkpoint;
+  SubEventPool* subEventPool;
+  StackingAction* stackingAction;
+  G4int eventOffset;
+  G4bool writeEventTree;
+  G4String fileOutName;
+
+  G4int eventNr;
+  G4double Edep[kNEdepSlots];
+  G4double Visible[kNEdepSlots];
+  // Scintillation + Cerenkov photons created, and the expected SiPM counts
+  // (LaBr3 yield times the per-channel collection efficiency)
+  G4double Yield[kNEdepSlots];
+  G4double Expected[kNSiPM];
+  std::vector<G4double> efficiency;
+  G4int nPhotonsTotal;
+  G4int vetoFlag;
+  G4double eventWeight;
+  G4double EdepWeighted;
+  G4ThreeVector EdepPosition;
+  G4int SiPMPhotons[kNSiPM];
+  G4int BGOPhotons[kNBGO];
+  G4double FirstPhotonTime;
+  G4int nDecays;
+  G4double LastDecayTime;
+
   TH1F* histogram1;
   TTree* ListMode;
   TFile* fileOut;
@@ -0,0 +1,67 @@
+#ifndef EventExporter_h
+#define EventExporter_h 1
+
+#include "globals.hh"
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+class G4GenericMessenger;
+
+// Writes fixed-shape per-event arrays for training loaders as sets of
+// NumPy .npy shards, <prefix>_<array>_<shard>.npy, each holding at most
+// eventsPerShard events:
+//   counts [N, nChannels]            float32, photons per channel
+//   times  [N, nChannels, timeBins]  float32, photon arrival histograms (optional)
+//   truth  [N, 7]                    float32, LaBr3 energy-weighted x, y, z [mm]
+//                                    in the module frame,
+//                                    LaBr3 Edep and visible energy, BGO Edep [MeV], weight
+//   event  [N]                       int64, event id
+// Headers are padded to 128 bytes, so the data starts 64-byte aligned and
+// can be memory-mapped without copying (numpy.load(..., mmap_mode="r")).
+class EventExporter
+{
+public:
+  static const G4int kNTruth = 7;
+
+  EventExporter(G4int nChannels);
+  ~EventExporter();
+
+  G4bool IsActive() const { return prefix != ""; }
+  G4bool WantsTimes() const { return timeBins > 0; }
+
+  void BeginEvent();
+  void AddPhotonTime(G4int channel, G4double time);
+  void Fill(G4int eventID, const float* counts, const float* truth);
+  void Close();
+
+  void SetPrefix(G4String name);
+
+private:
+  struct NpyFile {
+    std::ofstream out;
+    std::vector<G4int> rowShape;
+    std::int64_t nRows = 0;
+  };
+
+  void OpenShard();
+  void CloseShard();
+  void Open(NpyFile& file, const G4String& array, const char* descr, const std::vector<G4int>& rowShape);
+  void Finish(NpyFile& file, const char* descr);
+  static std::string Header(const char* descr, std::int64_t nRows, const std::vector<G4int>& rowShape);
+
+  G4GenericMessenger* messenger;
+  G4String prefix;
+  G4int nChannels;
+  G4int eventsPerShard;
+  G4int timeBins;
+  G4double timeBinWidth;
+
+  G4int shard;
+  G4bool shardOpen;
+  NpyFile countsFile, timesFile, truthFile, eventFile;
+  std::vector<float> timeRow;
+};
+
+#endif
@@ -30,16 +30,35 @@
 
 #include "globals.hh"
 
+// Histograms live in the (thread-local) G4AnalysisManager; on worker
+// threads they are merged into the master copy when the file is written.
+// Each run writes its own file, <fileName>_run<N>.root.
 class HistoManager
 {
 public:
-  HistoManager();
+  HistoManager(const G4String& fileName);
   ~HistoManager();
 
+  G4String GetFileName(G4int runID) const;
+
+  enum HistoId {
+    kEdepLaBr3 = 0,
+    kEdepBGO,
+    kSiPMPhotons,
+    kPhotonsPerEvent,
+    kBGOPhotons,
+    kFirstPhotonTime,
+    kDecayQ,
+    kDecayChainTime,
+    kDecayVisibleEnergy,
+    kArrayTime,
+    kEdepLaBr3Suppressed,
+    kNHisto
+  };
+
 private:
   void Book();
   G4String fFileName;
 };
 
 #endif
-
@@ -0,0 +1,16 @@
+#ifndef MemoryUsage_h
+#define MemoryUsage_h 1
+
+#include "globals.hh"
+
+// Resident memory of this process from /proc/self/status, in MB
+// (zero where /proc is not available).
+struct MemoryUsage
+{
+  G4double rss = 0.;
+  G4double peakRss = 0.;
+
+  static MemoryUsage Read();
+};
+
+#endif
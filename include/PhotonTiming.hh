@@ -0,0 +1,59 @@
+#ifndef PhotonTiming_h
+#define PhotonTiming_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+class G4GenericMessenger;
+
+// Timing estimators of every event, computed from the SiPM photon arrival
+// times with linear-time selection (std::nth_element) instead of a sort:
+//  - first, k-th and mean of the first k photon times of each channel,
+//  - the array timestamp, the k-th photon of all channels together.
+// Over the run the spread of the array timestamp gives the coincidence
+// time resolution of two such detectors, CTR = sqrt(2) x FWHM.
+// Estimators that need more photons than were detected are -1.
+class PhotonTiming
+{
+public:
+  PhotonTiming(G4int nChannels);
+  ~PhotonTiming();
+
+  G4bool IsActive() const {return kPhoton > 0;}
+
+  void Reset();
+  void Clear();
+  void AddPhoton(G4int channel, G4double time);
+  void EndOfEvent(G4double edepLaBr3);
+  void Report() const;
+
+  G4double* GetFirstTimes() {return firstTime.data();}
+  G4double* GetKthTimes() {return kthTime.data();}
+  G4double* GetMeanTimes() {return meanTime.data();}
+  G4double* GetArrayTimeAddress() {return &arrayTime;}
+  G4double GetArrayTime() const {return arrayTime;}
+
+private:
+  static void Estimate(std::vector<G4double>& times, G4int k, G4double& kth, G4double& mean);
+
+  G4GenericMessenger* messenger;
+
+  G4int kPhoton;
+  G4int kArray;
+  G4double peakMin;
+  G4double peakMax;
+
+  std::vector<std::vector<G4double>> times;
+  std::vector<G4double> allTimes;
+  std::vector<G4double> firstTime;
+  std::vector<G4double> kthTime;
+  std::vector<G4double> meanTime;
+  G4double arrayTime;
+
+  G4long nEvents;
+  G4double mean;
+  G4double m2;
+};
+
+#endif
@@ -1,8 +1,11 @@
+
 #ifndef PhysicsList_h
 #define PhysicsList_h 1
 
 #include "G4VModularPhysicsList.hh"
 #include "globals.hh"
+
+class G4GenericMessenger;
  
 class PhysicsList: public G4VModularPhysicsList
 {
@@ -11,8 +14,23 @@ public:
   virtual ~PhysicsList();
 
   virtual void SetCuts();
+
+  void AddRadioactiveDecay();
+  void SetYieldOnly(G4bool val);
+  void SetEmPhysics(G4String name);
+  void SetCrystalEmPhysics(G4String type);
+  void SetCutLaBr3(G4double cut) {cutLaBr3 = cut; SetRegionCut("LaBr3Region", cut);}
+  void SetCutBGO(G4double cut) {cutBGO = cut; SetRegionCut("BGORegion", cut);}
+  void SetCutPassive(G4double cut) {cutPassive = cut; SetRegionCut("PassiveRegion", cut);}
+
+private:
+  void SetRegionCut(const G4String& regionName, G4double cut);
+
+  G4GenericMessenger* messenger;
+  G4double cutLaBr3;
+  G4double cutBGO;
+  G4double cutPassive;
 };
  
  #endif
 
-
@@ -1,12 +1,26 @@
+
 #ifndef PrimaryGeneratorAction_h
 #define PrimaryGeneratorAction_h 1
 
 #include "G4VUserPrimaryGeneratorAction.hh"
+#include "G4ThreeVector.hh"
 #include "globals.hh"
 
+#include <vector>
+#include <map>
+
 class G4GeneralParticleSource;
+class G4GenericMessenger;
+class G4ParticleDefinition;
 class G4Event;
+class PrimaryList;
 
+// Source modes:
+//  gps     - one G4GeneralParticleSource vertex per decay (default)
+//  list    - decays read from a memory-mapped primary list file
+//  cascade - gamma cascades of a radionuclide, positioned by /gps/pos
+// With a non-zero rate every event is one integration window: the trigger
+// decay at t = 0 plus Poisson-distributed pile-up decays inside the window.
 class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
 public:
@@ -16,8 +30,50 @@ public:
   void GeneratePrimaries(G4Event* anEvent);
 
   G4GeneralParticleSource* GetParticleGun() const { return particleGun; }
+
+  void SetSourceMode(G4String mode);
+  void SetListFile(G4String name);
+  void AddCascadeLine(G4double energy);
+  void AddAnnihilation();
+  void SetCascadePreset(G4String nuclide);
+  void ClearCascade() {cascade.clear();}
+
+  G4bool IsListMode() const {return sourceMode == "list";}
+  const G4String& GetListFile() const {return listFileName;}
+  // Next record of the primary list, saved and restored by Checkpoint
+  G4long GetListPosition() const;
+  void SetListPosition(G4long record);
+
 private:
+  struct CascadeLine {
+    G4double energy;
+    G4double intensity;
+    G4bool annihilation;
+  };
+
+  void GenerateDecay(G4Event* anEvent, G4double t0);
+  void GenerateListDecay(G4Event* anEvent, G4double t0);
+  void GenerateCascadeDecay(G4Event* anEvent, G4double t0);
+  G4ParticleDefinition* FindParticle(G4int pdg);
+  void DefineCommands();
+
   G4GeneralParticleSource* particleGun;
+  G4GenericMessenger* messenger;
+
+  G4String sourceMode;
+  G4String listFileName;
+  G4int batchSize;
+  G4bool loopList;
+  PrimaryList* primaryList;
+  G4long listPosition;
+
+  std::vector<CascadeLine> cascade;
+  G4double lineIntensity;
+
+  G4double rate;
+  G4double window;
+
+  std::map<G4int, G4ParticleDefinition*> particleCache;
 };
 
 #endif
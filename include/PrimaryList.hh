@@ -0,0 +1,68 @@
+
+#ifndef PrimaryList_h
+#define PrimaryList_h 1
+
+#include "globals.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// One precomputed primary as stored on disk. Units are the Geant4 internal
+// ones (MeV, mm, ns). Consecutive records sharing the same decay id are
+// emitted together as one decay.
+struct PrimaryRecord
+{
+  double energy;
+  double pos[3];
+  double dir[3];
+  double time;
+  std::int32_t pdg;
+  std::int32_t decay;
+};
+
+static_assert(sizeof(PrimaryRecord) == 72, "PrimaryRecord layout must match the file format");
+
+// Header of a primary list file, followed by a packed array of PrimaryRecord.
+struct PrimaryListHeader
+{
+  char magic[8];             // "LABRPRIM"
+  std::uint32_t version;     // 1
+  std::uint32_t recordSize;  // sizeof(PrimaryRecord)
+};
+
+// Read-only, memory-mapped view of a primary list file. Records are copied
+// out of the mapping in batches; the kernel is asked to read the following
+// batch ahead while the current one is being simulated.
+class PrimaryList
+{
+public:
+  PrimaryList(const G4String& fileName, G4int batchSize);
+  ~PrimaryList();
+
+  const PrimaryRecord* Next();
+  const PrimaryRecord* Peek();
+  void Rewind();
+  // Index of the record Next() returns, for checkpoints
+  std::size_t Tell() const {return nextRecord - batch.size() + batchPos;}
+  void Seek(std::size_t record);
+
+  std::size_t GetNumberOfRecords() const {return nRecords;}
+
+private:
+  void Prefetch();
+
+  G4String fileName;
+  int fd;
+  void* mapped;
+  std::size_t mappedSize;
+  const PrimaryRecord* records;
+  std::size_t nRecords;
+  std::size_t nextRecord;
+
+  std::vector<PrimaryRecord> batch;
+  std::size_t batchSize;
+  std::size_t batchPos;
+};
+
+#endif
@@ -9,16 +9,26 @@
 using namespace std;
 
 class G4Run;
+class HistoManager;
+class ConvergenceMonitor;
+class PhotonTiming;
 
 class RunAction : public G4UserRunAction
 {
 public:
-  RunAction();
+  RunAction(G4String nameAdd);
   ~RunAction();
 
   void BeginOfRunAction(const G4Run*);
   void EndOfRunAction(const G4Run*);
+
+  ConvergenceMonitor* GetConvergenceMonitor() const {return convergenceMonitor;}
+  PhotonTiming* GetPhotonTiming() const {return photonTiming;}
+
+private:
+  HistoManager* histoManager;
+  ConvergenceMonitor* convergenceMonitor;
+  PhotonTiming* photonTiming;
 };
 
 #endif
-
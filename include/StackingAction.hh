@@ -0,0 +1,57 @@
+
+#ifndef StackingAction_h
+#define StackingAction_h 1
+
+#include "G4UserStackingAction.hh"
+#include "globals.hh"
+
+class EventAction;
+class SubEventPool;
+class G4GenericMessenger;
+class G4ParticleDefinition;
+class G4LogicalVolume;
+
+// Event filter (/LaBr/filter/). While a filter is set, optical photons are
+// held in the waiting stack until all other particles are tracked. The
+// LaBr3 deposit then decides: events that pass get their photons tracked,
+// the others are aborted and counted. Events that made no optical photons
+// (all of them with /LaBr/phys/yieldOnly) get the same decision at the end
+// of the event (AcceptEvent), where the rejected ones are not filled.
+// Photons made in the BGO after a BGO veto (/LaBr/veto/) are killed.
+class StackingAction : public G4UserStackingAction
+{
+public:
+  StackingAction(EventAction* evAction);
+  ~StackingAction();
+
+  G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* aTrack);
+  void NewStage();
+  void PrepareNewEvent();
+  // Decision for events that never reached the optical stage
+  G4bool AcceptEvent();
+
+  void PrintStatistics() const;
+  void SetSubEventPool(SubEventPool* val) {subEventPool = val;}
+
+private:
+  G4bool IsActive() const { return minEdep > 0. || peakMax > 0.; }
+  G4bool Passes() const;
+
+  EventAction* eventAction;
+  SubEventPool* subEventPool;
+  G4GenericMessenger* messenger;
+  const G4ParticleDefinition* opticalPhoton;
+  const G4LogicalVolume* lLaBr3;
+  const G4LogicalVolume* lBGO;
+
+  G4double minEdep;
+  G4double peakMin;
+  G4double peakMax;
+
+  G4bool opticalStage;
+  G4long nEvents;
+  G4long nAccepted;
+  G4long nRejected;
+};
+
+#endif
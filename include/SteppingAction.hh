@@ -2,6 +2,7 @@
 #define SteppingAction_h 1
 
 #include "G4UserSteppingAction.hh"
+#include "SubEventPool.hh"
 #include "G4String.hh"
 #include "globals.hh"
 
@@ -11,27 +12,95 @@
 #include "TH2F.h"
 #include "TH3I.h"
 
+#include <chrono>
+#include <memory>
+
 class EventAction;
+class Watchdog;
+class G4GenericMessenger;
+class G4LogicalVolume;
+class G4VPhysicalVolume;
+class G4ParticleDefinition;
+class G4EmSaturation;
+class G4Scintillation;
+class G4Cerenkov;
+class G4MaterialPropertyVector;
 
 class SteppingAction : public G4UserSteppingAction
 {
 public:
-  SteppingAction(G4int*, G4String nameAdd);
+  SteppingAction(G4int*, G4String nameAdd, EventAction* evAction);
   ~SteppingAction();
 
   void UserSteppingAction(const G4Step*);
   void InitVar();
   void InitOutput();
+  void PrintStatistics() const;
 
   void SetOutputFileName(G4String val) {foutName=val;}
+  const G4String& GetOutputFileName() const {return foutName;}
+  Long64_t SaveCheckpoint();
+  G4bool ResumeOutput(const G4String& fileName, Long64_t entries);
+
+  // Sub-event mode (/LaBr/subevent/workers)
+  void SetSubEventPool(SubEventPool* val) {subEventPool = val;}
+  void StoreHit(const PhotonHit& hit);
+  OpticalCounts GetOpticalCounts() const;
+  void AddOpticalCounts(const OpticalCounts& counts);
+  Watchdog* GetWatchdog() const {return watchdog;}
 
   G4double  k_primary;
-  TFile *fout;
-  TTree *tout;
+  std::unique_ptr<TFile> fout;
+  TTree *tout;  // owned by fout
 private:
+  void CacheVolumes();
+  void AttachBranches(G4bool create);
+  void RecordPhoton(const G4Step*);
+  void ProcessStep(const G4Step*);
+  void FillRow();
+  void SaveBlock();
+  Long64_t BufferedBytes() const;
+  void EndOfEvent();
+
   EventAction* eventAction;
-  G4int currentEv;
+  Watchdog* watchdog;
+  SubEventPool* subEventPool;
+  G4GenericMessenger* messenger;
+  G4bool writeStepTree;
+  G4bool writeEdepSteps;
+  G4int autoSaveEvery;
+  G4double basketMemory;
+  G4int lastEvent;
+  G4int eventsSinceSave;
+  G4int nBlocks;
   G4int *evNr;
+
+  const G4ParticleDefinition* opticalPhoton;
+  const G4LogicalVolume* lLaBr3;
+  const G4LogicalVolume* lBGO;
+  const G4LogicalVolume* lSiPM;
+  const G4LogicalVolume* lReflector;
+  const G4LogicalVolume* lReflectorFace;
+  const G4LogicalVolume* lTeflon;
+  const G4LogicalVolume* lHousing;
+  const G4VPhysicalVolume* physiBGOSiPM;
+  G4EmSaturation* emSaturation;
+  const G4Scintillation* scintillation;
+  const G4Cerenkov* cerenkov;
+  // Grease absorption with the coated window-SiPM coupling
+  G4double couplingThickness;
+  const G4MaterialPropertyVector* greaseRindex;
+  const G4MaterialPropertyVector* greaseAbsLength;
+  const G4MaterialPropertyVector* sipmRindex;
+
+  G4long nSteps;
+  G4long nOpticalSteps;
+  G4long nFastPath;
+  G4long nOpticalPhotons;
+  G4long nRows;
+  G4long nCouplingAbsorbed;
+  G4long nEvents;
+  std::chrono::steady_clock::time_point startTime;
    
   G4int eventNr;
   G4int pType;
@@ -52,12 +121,11 @@ private:
   G4double postPosY;
   G4double postPosZ;
   G4int CopyNo;
-    
-  G4int counter;
 
   G4double momentumX;
   G4double momentumY;
   G4double momentumZ;
+  G4double weight;
 };
 
 #endif
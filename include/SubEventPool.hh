@@ -0,0 +1,94 @@
+#ifndef SubEventPool_h
+#define SubEventPool_h 1
+
+#include "globals.hh"
+#include "Watchdog.hh"
+
+#include <vector>
+
+class G4GenericMessenger;
+class G4Track;
+class SteppingAction;
+
+// Optical photon as it was stacked, enough to track it again
+struct StackedPhoton {
+  G4double position[3];
+  G4double direction[3];
+  G4double polarization[3];
+  G4double energy;
+  G4double time;
+  G4double weight;
+  G4int trackID;
+  G4int parentID;
+};
+
+// Photon absorbed in a SiPM, as RecordPhoton would have stored it
+struct PhotonHit {
+  G4double position[3];
+  G4double time;
+  G4double edep;
+  G4double vertexEnergy;
+  G4double weight;
+  G4int copy;
+  G4int module;
+  G4bool inBGO;
+};
+
+// Step counters of SteppingAction that sub-events report back
+struct OpticalCounts {
+  G4long steps;
+  G4long opticalSteps;
+  G4long fastPath;
+  G4long photons;
+  G4long couplingAbsorbed;
+};
+
+// Sub-event parallelism for single large events. The optical photons
+// created in LaBr3 are taken off the stack (StackingAction) and, at the
+// end of the event, tracked in batches by forked worker processes that
+// share the initialised geometry and physics tables copy-on-write. The
+// SiPM hits come back through pipes and are stored in batch order, and
+// every batch seeds its engine from one number drawn per event and the
+// batch index, so the output does not depend on the number of workers.
+// BGO photons stay on the normal stack, as the veto needs them.
+// The watchdog counts of every batch come back with its hits; the event
+// is aborted, and none of its hits stored, when any batch was stopped or
+// all of them together go over the event limits.
+class SubEventPool
+{
+public:
+  SubEventPool(SteppingAction* stAction);
+  ~SubEventPool();
+
+  G4bool IsActive() const {return workers > 0;}
+  G4bool IsWorker() const {return worker;}
+
+  void AddPhoton(const G4Track* track);
+  void Collect(const PhotonHit& hit) {hits.push_back(hit);}
+  // False when the watchdog aborted the event
+  G4bool Process();
+  void Clear() {photons.clear();}
+
+private:
+  void RunBatch(std::size_t batch, long eventSeed, int fd);
+  G4bool ReadCounts(const std::vector<char>& data, OpticalCounts& counts, WatchdogCounts& watchdogCounts) const;
+  void StoreHits(const std::vector<char>& data);
+
+  G4GenericMessenger* messenger;
+  SteppingAction* steppingAction;
+
+  G4int workers;
+  G4int batchSize;
+  G4bool worker;
+  std::vector<StackedPhoton> photons;
+  std::vector<PhotonHit> hits;
+
+  G4long nEvents;
+  G4long nBatches;
+  G4long nPhotons;
+  G4long nFailed;
+  G4long nAborted;
+  G4double wallTime;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef TrackingAction_h
+#define TrackingAction_h 1
+
+#include "G4UserTrackingAction.hh"
+#include "globals.hh"
+
+class G4GenericMessenger;
+class G4ParticleDefinition;
+
+// Trajectory filter for visualising optical runs (/LaBr/vis/). Primaries,
+// charged and other non-optical tracks keep the trajectory type chosen by
+// /tracking/storeTrajectory (smooth with /vis/scene/add/trajectories
+// smooth). Of the optical photons only a sampled fraction, at most
+// maxPhotons per event, store a trajectory, and a plain one without
+// auxiliary points. Dropped photons never create a trajectory, so the
+// memory is saved, not only the drawing. The sample is a hash of the
+// event and track IDs, so it does not draw from the engine and the
+// physics is the same with and without visualisation.
+class TrackingAction : public G4UserTrackingAction
+{
+public:
+  TrackingAction();
+  ~TrackingAction();
+
+  void PreUserTrackingAction(const G4Track*);
+  void PostUserTrackingAction(const G4Track*);
+
+private:
+  G4bool IsActive() const {return photonFraction < 1. || maxPhotons > 0;}
+  G4bool KeepPhoton(const G4Track*);
+
+  G4GenericMessenger* messenger;
+  const G4ParticleDefinition* opticalPhoton;
+
+  G4double photonFraction;
+  G4int maxPhotons;
+
+  G4int storeMode;
+  G4int currentEvent;
+  G4int eventPhotons;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef Watchdog_h
+#define Watchdog_h 1
+
+#include "globals.hh"
+
+#include <chrono>
+#include <fstream>
+
+class G4GenericMessenger;
+class G4Track;
+class G4Step;
+
+// Watchdog counts of one event that a sub-event worker reports back
+struct WatchdogCounts {
+  G4long steps;
+  G4int killedTracks;
+  G4int abortReason;
+};
+
+// Bounds the cost of single events (/LaBr/watchdog/), typically optical
+// photons trapped by total internal reflection in the LaBr3:
+//  - a track over maxTrackSteps steps is killed,
+//  - an event over maxEventSteps steps or maxEventTime of wall time is
+//    aborted.
+// Every affected event is listed in Watchdog_<tag>.txt with the reason.
+// The step limits are reproducible, the wall-time limit is not.
+// The limits hold for the whole event also in the sub-event mode: a worker
+// starts from the steps and the start time of its event, so it stops its
+// batch once the rest of the budget is used, and the event adds up the
+// counts of all batches (AddEventCounts). Workers never write the list.
+class Watchdog
+{
+public:
+  Watchdog(G4String nameAdd);
+  ~Watchdog();
+
+  G4bool IsActive() const {return maxTrackSteps > 0 || maxEventSteps > 0 || maxEventTime > 0.;}
+
+  void BeginEvent(G4int eventNr);
+  // False when the track or the event of this step was stopped
+  G4bool Check(const G4Step* aStep);
+  void PrintStatistics() const;
+
+  // Sub-event mode (SubEventPool)
+  void SetWorker() {worker = true;}
+  G4bool IsEventAborted() const {return abortReason != kNotAborted;}
+  WatchdogCounts GetEventCounts() const {return {eventSteps, eventKilledTracks, abortReason};}
+  void AddEventCounts(const WatchdogCounts& counts);
+
+private:
+  enum AbortReason {kNotAborted, kEventSteps, kWallTime};
+
+  void EndEvent();
+  void AbortEvent(G4int reason, G4Track* track);
+  G4bool OverTime() const;
+  std::ofstream& Log();
+
+  G4GenericMessenger* messenger;
+
+  G4int maxTrackSteps;
+  G4long maxEventSteps;
+  G4double maxEventTime;
+
+  G4String logName;
+  std::ofstream log;
+
+  G4int currentEvent;
+  G4long eventSteps;
+  G4int eventKilledTracks;
+  G4int abortReason;
+  G4bool worker;
+  std::chrono::steady_clock::time_point eventStart;
+
+  G4long nEvents;
+  G4long nKilledTracks;
+  G4long nTrackEvents;
+  G4long nAbortedEvents;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#include "BGOVeto.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+BGOVeto::BGOVeto()
+  : threshold(0), windowStart(0.), windowEnd(100.*ns), mode("tag"), nPhotons(0), vetoed(false), nEvents(0), nVetoed(0)
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/veto/", "BGO anti-Compton veto");
+  messenger->DeclareProperty("threshold", threshold, "BGO SiPM photons in the window that veto the event (0 = off)")
+    .SetRange("threshold>=0");
+  messenger->DeclarePropertyWithUnit("windowStart", "ns", windowStart, "Start of the veto time window");
+  messenger->DeclarePropertyWithUnit("windowEnd", "ns", windowEnd, "End of the veto time window");
+  messenger->DeclareProperty("mode", mode, "Tag vetoed events or drop them from the output")
+    .SetCandidates("tag drop");
+}
+
+BGOVeto::~BGOVeto()
+{
+  PrintStatistics();
+  delete messenger;
+}
+
+// True for the photon that vetoes the event
+G4bool BGOVeto::AddPhoton(G4double time)
+{
+  if (!IsActive() || vetoed) return false;
+  if (time < windowStart || time > windowEnd) return false;
+
+  if (++nPhotons < threshold) return false;
+  vetoed = true;
+  return true;
+}
+
+void BGOVeto::EndOfEvent()
+{
+  if (!IsActive()) return;
+  nEvents++;
+  if (vetoed) nVetoed++;
+}
+
+void BGOVeto::PrintStatistics() const
+{
+  if (nEvents == 0) return;
+
+  G4cout << "BGO veto: " << nEvents << " events, " << nVetoed << " vetoed (" << 100.*nVetoed/nEvents << " %, "
+         << (DropsEvents() ? "dropped" : "tagged") << "), threshold " << threshold << " photons in "
+         << windowStart/ns << "-" << windowEnd/ns << " ns" << G4endl;
+}
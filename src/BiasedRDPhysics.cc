@@ -0,0 +1,140 @@
+#include "BiasedRDPhysics.hh"
+
+#include "G4PhysicsListHelper.hh"
+#include "G4UAtomicDeexcitation.hh"
+#include "G4LeptonConstructor.hh"
+#include "G4BosonConstructor.hh"
+#include "G4BaryonConstructor.hh"
+#include "G4GenericMessenger.hh"
+#include "G4LossTableManager.hh"
+#include "G4IonConstructor.hh"
+#include "G4Radioactivation.hh"
+#include "G4NucleusLimits.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4EmParameters.hh"
+#include "G4GenericIon.hh"
+#include "G4Version.hh"
+#if G4VERSION_NUMBER >= 1120
+#include "G4HadronicParameters.hh"
+#endif
+
+BiasedRDPhysics::BiasedRDPhysics(G4int verbose)
+  : BiasedRDPhysics(G4String("BiasedRDPhysics"))
+{
+  verboseLevel = verbose;
+}
+
+BiasedRDPhysics::BiasedRDPhysics(const G4String& name)
+  : G4VPhysicsConstructor(name), radioactivation(nullptr), messenger(nullptr),
+    splitNuclei(1), brBias(false), decayBiasFile(""), sourceTimeFile(""), volumeName(""),
+    aMin(1), aMax(250), zMin(1), zMax(100)
+{
+  DefineCommands();
+}
+
+BiasedRDPhysics::~BiasedRDPhysics()
+{
+  delete messenger;
+}
+
+void BiasedRDPhysics::ConstructParticle()
+{
+  G4BosonConstructor bosons;
+  bosons.ConstructParticle();
+  G4LeptonConstructor leptons;
+  leptons.ConstructParticle();
+  G4BaryonConstructor baryons;
+  baryons.ConstructParticle();
+  G4IonConstructor ions;
+  ions.ConstructParticle();
+}
+
+void BiasedRDPhysics::ConstructProcess()
+{
+  G4EmParameters* emParams = G4EmParameters::Instance();
+  emParams->SetAugerCascade(true);
+  emParams->SetDeexcitationIgnoreCut(true);
+
+  G4LossTableManager* lossManager = G4LossTableManager::Instance();
+  if (!lossManager->AtomDeexcitation()) {
+    lossManager->SetAtomDeexcitation(new G4UAtomicDeexcitation());
+  }
+
+  radioactivation = new G4Radioactivation();
+
+  // La-138 lives ~1e11 years, longer than the default threshold above which
+  // Geant4 treats a nucleus as stable and kills it without decaying.
+#if G4VERSION_NUMBER >= 1120
+  G4HadronicParameters::Instance()->SetTimeThresholdForRadioactiveDecay(1.0e+60*year);
+#else
+  radioactivation->SetThresholdForVeryLongDecayTime(1.0e+60*year);
+#endif
+
+  if (splitNuclei > 1) radioactivation->SetSplitNuclei(splitNuclei);
+  if (brBias) radioactivation->SetBRBias(true);
+  if (decayBiasFile != "") radioactivation->SetDecayBias(decayBiasFile);
+  if (sourceTimeFile != "") radioactivation->SetSourceTimeProfile(sourceTimeFile);
+  if (volumeName != "") radioactivation->SelectAVolume(volumeName);
+  ApplyNucleusLimits();
+
+  G4PhysicsListHelper::GetPhysicsListHelper()->RegisterProcess(radioactivation, G4GenericIon::GenericIon());
+
+  if (verboseLevel > 0) {
+    G4cout << "BiasedRDPhysics: split " << splitNuclei << ", BR bias " << brBias
+           << ", decay bias '" << decayBiasFile << "', source profile '" << sourceTimeFile
+           << "', A " << aMin << "-" << aMax << ", Z " << zMin << "-" << zMax << G4endl;
+  }
+}
+
+void BiasedRDPhysics::SetSplitNuclei(G4int n)
+{
+  splitNuclei = n;
+  if (radioactivation && n > 1) radioactivation->SetSplitNuclei(n);
+}
+
+void BiasedRDPhysics::SetBRBias(G4bool val)
+{
+  brBias = val;
+  if (radioactivation) radioactivation->SetBRBias(val);
+}
+
+void BiasedRDPhysics::SetDecayBias(G4String fileName)
+{
+  decayBiasFile = fileName;
+  if (radioactivation) radioactivation->SetDecayBias(fileName);
+}
+
+void BiasedRDPhysics::SetSourceTimeProfile(G4String fileName)
+{
+  sourceTimeFile = fileName;
+  if (radioactivation) radioactivation->SetSourceTimeProfile(fileName);
+}
+
+void BiasedRDPhysics::SelectVolume(G4String name)
+{
+  volumeName = name;
+  if (radioactivation) radioactivation->SelectAVolume(name);
+}
+
+void BiasedRDPhysics::ApplyNucleusLimits()
+{
+  if (radioactivation) radioactivation->SetNucleusLimits(G4NucleusLimits(aMin, aMax, zMin, zMax));
+}
+
+void BiasedRDPhysics::DefineCommands()
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/rdm/", "Biased radioactive decay");
+
+  messenger->DeclareMethod("splitNuclei", &BiasedRDPhysics::SetSplitNuclei, "Number of copies of each decaying nucleus")
+    .SetParameterName("n", false)
+    .SetRange("n>=1");
+  messenger->DeclareMethod("branchingBias", &BiasedRDPhysics::SetBRBias, "Sample decay branches uniformly and weight them");
+  messenger->DeclareMethod("decayBiasProfile", &BiasedRDPhysics::SetDecayBias, "Time-window decay bias file");
+  messenger->DeclareMethod("sourceTimeProfile", &BiasedRDPhysics::SetSourceTimeProfile, "Source time profile file");
+  messenger->DeclareMethod("selectVolume", &BiasedRDPhysics::SelectVolume, "Only decay nuclei in this logical volume");
+  messenger->DeclareProperty("aMin", aMin, "Lowest A of decaying nuclei (applied by applyNucleusLimits)");
+  messenger->DeclareProperty("aMax", aMax, "Highest A of decaying nuclei (applied by applyNucleusLimits)");
+  messenger->DeclareProperty("zMin", zMin, "Lowest Z of decaying nuclei (applied by applyNucleusLimits)");
+  messenger->DeclareProperty("zMax", zMax, "Highest Z of decaying nuclei (applied by applyNucleusLimits)");
+  messenger->DeclareMethod("applyNucleusLimits", &BiasedRDPhysics::ApplyNucleusLimits, "Restrict decays to the A/Z window");
+}
@@ -0,0 +1,129 @@
+#include "Checkpoint.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "SteppingAction.hh"
+#include "EventAction.hh"
+#include "Analysis.hh"
+
+#include "G4GenericMessenger.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <cstdio>
+#include <fstream>
+
+Checkpoint::Checkpoint(G4String nameAdd, EventAction* evAction, SteppingAction* stAction,
+                       PrimaryGeneratorAction* primAction)
+  : eventAction(evAction), steppingAction(stAction), primaryAction(primAction), fileName("Checkpoint_" + nameAdd), saveEvery(0),
+    eventsSinceSave(0), sameFile(true), nSaved(0)
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/checkpoint/", "Checkpoint and resume of long runs");
+  messenger->DeclareProperty("every", saveEvery, "Events between checkpoints (0 = none)")
+    .SetRange("every>=0");
+  messenger->DeclareProperty("file", fileName, "Checkpoint file prefix (<file>.state, <file>.rng)");
+  messenger->DeclareProperty("sameFile", sameFile, "On resume, append to the output files of the checkpoint");
+  messenger->DeclareMethod("resume", &Checkpoint::Resume, "Continue from a <file>.state checkpoint (before /run/beamOn)")
+    .SetStates(G4State_Idle);
+}
+
+Checkpoint::~Checkpoint()
+{
+  delete messenger;
+  if (nSaved > 0) {
+    G4cout << "Checkpoint: " << nSaved << " checkpoints saved to " << fileName << ".state" << G4endl;
+  }
+}
+
+void Checkpoint::EndOfEvent(G4int eventNr)
+{
+  if (saveEvery > 0 && ++eventsSinceSave >= saveEvery) {
+    Save(eventNr);
+  }
+}
+
+void Checkpoint::Save(G4int eventNr)
+{
+  Long64_t stepEntries = steppingAction->SaveCheckpoint();
+  Long64_t eventEntries = eventAction->SaveCheckpoint();
+
+  G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+  if (analysisManager->IsActive()) {
+    analysisManager->Write();
+  }
+
+  // Both files are written aside and renamed, so a job killed in the
+  // middle leaves the previous checkpoint usable.
+  G4String rngFile = fileName + ".rng";
+  G4String stateFile = fileName + ".state";
+  G4Random::saveEngineStatus((rngFile + ".tmp").c_str());
+  {
+    std::ofstream state(stateFile + ".tmp", std::ios::trunc);
+    state << "event " << eventNr << "\n"
+          << "rng " << rngFile << "\n"
+          << "stepTree " << steppingAction->GetOutputFileName() << " " << stepEntries << "\n"
+          << "eventTree " << eventAction->GetOutputFileName() << " " << eventEntries << "\n";
+    if (primaryAction->IsListMode()) {
+      state << "primaryList " << primaryAction->GetListFile() << " " << primaryAction->GetListPosition() << "\n";
+    }
+  }
+  std::rename((rngFile + ".tmp").c_str(), rngFile.c_str());
+  std::rename((stateFile + ".tmp").c_str(), stateFile.c_str());
+
+  eventsSinceSave = 0;
+  nSaved++;
+}
+
+void Checkpoint::Resume(G4String stateFile)
+{
+  std::ifstream in(stateFile);
+  if (!in) {
+    G4ExceptionDescription ed;
+    ed << "Cannot open checkpoint " << stateFile;
+    G4Exception("Checkpoint::Resume()", "Checkpoint001", JustWarning, ed);
+    return;
+  }
+
+  G4int lastEvent = -1;
+  G4String rngFile, stepFile, eventFile, listFile;
+  Long64_t stepEntries = 0, eventEntries = 0;
+  G4long listPosition = -1;
+  std::string key;
+  while (in >> key) {
+    if (key == "event") in >> lastEvent;
+    else if (key == "rng") in >> rngFile;
+    else if (key == "stepTree") in >> stepFile >> stepEntries;
+    else if (key == "eventTree") in >> eventFile >> eventEntries;
+    else if (key == "primaryList") in >> listFile >> listPosition;
+  }
+  if (lastEvent < 0 || rngFile.empty()) {
+    G4ExceptionDescription ed;
+    ed << stateFile << " is not a checkpoint state file";
+    G4Exception("Checkpoint::Resume()", "Checkpoint002", JustWarning, ed);
+    return;
+  }
+
+  // Restarting the list would repeat the decays already simulated
+  if (primaryAction->IsListMode() && (listPosition < 0 || listFile != primaryAction->GetListFile())) {
+    G4ExceptionDescription ed;
+    ed << stateFile << " holds no position in primary list " << primaryAction->GetListFile()
+       << "; set /LaBr/source/mode and listFile as in the checkpointed job before resuming";
+    G4Exception("Checkpoint::Resume()", "Checkpoint003", JustWarning, ed);
+    return;
+  }
+  if (listPosition >= 0) primaryAction->SetListPosition(listPosition);
+
+  G4Random::restoreEngineStatus(rngFile.c_str());
+  eventAction->SetEventOffset(lastEvent + 1);
+
+  if (sameFile) {
+    if (stepEntries > 0 && !steppingAction->ResumeOutput(stepFile, stepEntries)) {
+      G4cout << "Checkpoint: " << stepFile << " does not match the checkpoint, step tree goes to "
+             << steppingAction->GetOutputFileName() << G4endl;
+    }
+    if (eventEntries > 0 && !eventAction->ResumeOutput(eventFile, eventEntries)) {
+      G4cout << "Checkpoint: " << eventFile << " does not match the checkpoint, event tree goes to "
+             << eventAction->GetOutputFileName() << G4endl;
+    }
+  }
+
+  G4cout << "Checkpoint: resuming after event " << lastEvent << " of " << stateFile << G4endl;
+}
@@ -0,0 +1,116 @@
+#include "ConvergenceMonitor.hh"
+#include "EventAction.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4RunManager.hh"
+#include "G4ios.hh"
+
+#include <iomanip>
+
+void ConvergenceMonitor::RunningStat::Add(G4double x)
+{
+  n++;
+  G4double delta = x - mean;
+  mean += delta/n;
+  m2 += delta*(x - mean);
+}
+
+ConvergenceMonitor::ConvergenceMonitor()
+  : nEvents(0), peakMin(0.), peakMax(0.), centroidTarget(0.), resolutionTarget(0.), photonTarget(0.),
+    checkInterval(1000), minEvents(1000)
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/monitor/", "Online convergence monitoring");
+  messenger->DeclarePropertyWithUnit("peakMin", "keV", peakMin, "Lower edge of the photopeak window in LaBr3 Edep");
+  messenger->DeclarePropertyWithUnit("peakMax", "keV", peakMax, "Upper edge of the photopeak window in LaBr3 Edep");
+  messenger->DeclareProperty("centroidPrecision", centroidTarget, "Relative precision of the photopeak centroid (0 = off)");
+  messenger->DeclareProperty("resolutionPrecision", resolutionTarget, "Relative precision of the photopeak resolution (0 = off)");
+  messenger->DeclareProperty("photonPrecision", photonTarget, "Relative precision of the mean photons per SiPM (0 = off)");
+  messenger->DeclareProperty("checkEvery", checkInterval, "Number of events between convergence checks")
+    .SetRange("checkEvery>0");
+  messenger->DeclareProperty("minEvents", minEvents, "Events simulated before the run may stop");
+}
+
+ConvergenceMonitor::~ConvergenceMonitor()
+{
+  delete messenger;
+}
+
+void ConvergenceMonitor::Reset()
+{
+  peak = RunningStat();
+  photonsPerSiPM = RunningStat();
+  nEvents = 0;
+}
+
+void ConvergenceMonitor::AddEvent(G4double edepLaBr3, G4int nPhotons)
+{
+  nEvents++;
+  photonsPerSiPM.Add(G4double(nPhotons)/EventAction::kNSiPM);
+  if (peakMax > peakMin && edepLaBr3 >= peakMin && edepLaBr3 <= peakMax) {
+    peak.Add(nPhotons);
+  }
+
+  if (centroidTarget <= 0. && resolutionTarget <= 0. && photonTarget <= 0.) return;
+  if (nEvents < minEvents || nEvents % checkInterval != 0) return;
+
+  if (Converged(true)) {
+    G4cout << "ConvergenceMonitor: requested precision reached after " << nEvents << " events, stopping the run" << G4endl;
+    G4RunManager::GetRunManager()->AbortRun(true);
+  }
+}
+
+G4double ConvergenceMonitor::CentroidPrecision() const
+{
+  if (peak.n < 2 || peak.mean <= 0.) return DBL_MAX;
+  return peak.ErrorOfMean()/peak.mean;
+}
+
+G4double ConvergenceMonitor::ResolutionPrecision() const
+{
+  if (peak.n < 3 || peak.Variance() <= 0.) return DBL_MAX;
+  // Gaussian approximation: sigma is known to 1/sqrt(2(n-1)) relative
+  G4double sigmaPrecision = 1./std::sqrt(2.*(peak.n - 1));
+  G4double centroidPrecision = CentroidPrecision();
+  return std::sqrt(sigmaPrecision*sigmaPrecision + centroidPrecision*centroidPrecision);
+}
+
+G4double ConvergenceMonitor::PhotonPrecision() const
+{
+  if (photonsPerSiPM.n < 2 || photonsPerSiPM.mean <= 0.) return DBL_MAX;
+  return photonsPerSiPM.ErrorOfMean()/photonsPerSiPM.mean;
+}
+
+G4bool ConvergenceMonitor::Converged(G4bool print) const
+{
+  G4double centroid = CentroidPrecision();
+  G4double resolution = ResolutionPrecision();
+  G4double photons = PhotonPrecision();
+
+  if (print) {
+    G4cout << "ConvergenceMonitor: " << nEvents << " events, peak events " << peak.n
+           << ", centroid " << centroid << "/" << centroidTarget
+           << ", resolution " << resolution << "/" << resolutionTarget
+           << ", photons/SiPM " << photons << "/" << photonTarget << G4endl;
+  }
+
+  if (centroidTarget > 0. && centroid > centroidTarget) return false;
+  if (resolutionTarget > 0. && resolution > resolutionTarget) return false;
+  if (photonTarget > 0. && photons > photonTarget) return false;
+  return true;
+}
+
+void ConvergenceMonitor::Report() const
+{
+  if (nEvents == 0) return;
+
+  G4cout << "---- Convergence summary (" << nEvents << " events)" << G4endl;
+  G4cout << "  mean photons per SiPM : " << photonsPerSiPM.mean << " +- " << photonsPerSiPM.ErrorOfMean() << G4endl;
+  if (peak.n > 2) {
+    G4double sigma = std::sqrt(peak.Variance());
+    G4double resolution = 2.355*sigma/peak.mean;
+    G4cout << "  photopeak events      : " << peak.n << G4endl;
+    G4cout << "  photopeak centroid    : " << peak.mean << " +- " << peak.ErrorOfMean() << " photons" << G4endl;
+    G4cout << "  photopeak FWHM/E      : " << 100.*resolution << " +- " << 100.*resolution*ResolutionPrecision() << " %" << G4endl;
+  }
+}
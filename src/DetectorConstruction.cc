@@ -1,6 +1,10 @@
 #include "DetectorConstruction.hh"
+#include "OpticalPropertyRegistry.hh"
 
 #include "G4LogicalBorderSurface.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
 #include "G4OpticalSurface.hh"
 #include "G4LogicalVolume.hh"
 #include "G4MaterialTable.hh"
@@ -15,14 +19,88 @@
 #include "G4Box.hh"
 #include "G4Tubs.hh"
 #include "G4LogicalSkinSurface.hh"
+#include "G4Region.hh"
+#include "G4Version.hh"
+
+#include <algorithm>
+#include <cmath>
 
 using namespace CLHEP;
 
 DetectorConstruction::DetectorConstruction()
-{}
+  : Layout("grid"), NModules(1), Columns(0), Pitch(72.*mm), RingRadius(0.), CouplingModel("volume"), CouplingThickness(0.)
+{
+  opticalProperties = new OpticalPropertyRegistry();
+
+  messenger = new G4GenericMessenger(this, "/LaBr/array/", "Array of detector modules");
+  messenger->DeclareProperty("layout", Layout, "Module arrangement")
+    .SetCandidates("grid ring")
+    .SetStates(G4State_PreInit);
+  messenger->DeclareProperty("nModules", NModules, "Number of modules")
+    .SetRange("nModules>=1")
+    .SetStates(G4State_PreInit);
+  messenger->DeclareProperty("columns", Columns, "Modules per grid row (0 = square grid)")
+    .SetRange("columns>=0")
+    .SetStates(G4State_PreInit);
+  messenger->DeclarePropertyWithUnit("pitch", "mm", Pitch, "Distance between grid modules")
+    .SetStates(G4State_PreInit);
+  messenger->DeclarePropertyWithUnit("ringRadius", "mm", RingRadius, "Distance of the ring modules from the centre (0 = closest)")
+    .SetStates(G4State_PreInit);
+
+  couplingMessenger = new G4GenericMessenger(this, "/LaBr/coupling/", "Window to SiPM optical coupling");
+  couplingMessenger->DeclareProperty("model", CouplingModel, "Optical grease as a volume or as a coated surface")
+    .SetCandidates("volume coated")
+    .SetStates(G4State_PreInit);
+}
 
 DetectorConstruction::~DetectorConstruction()
-{}
+{
+  delete couplingMessenger;
+  delete messenger;
+  delete opticalProperties;
+}
+
+std::vector<G4Transform3D> DetectorConstruction::ModuleTransforms(G4double moduleR, G4double moduleHalfZ, G4double& extent) const
+{
+  std::vector<G4Transform3D> placements;
+  G4double moduleDiagonal = std::hypot(moduleR, moduleHalfZ);
+
+  if (Layout == "ring" && NModules > 1) {
+    // Neighbouring envelopes touch first at their inner faces
+    G4double minRadius = moduleR/std::sin(pi/NModules) + moduleHalfZ;
+    G4double radius = RingRadius > 0. ? RingRadius : minRadius;
+    if (radius < minRadius) {
+      G4ExceptionDescription ed;
+      ed << "A ring of " << NModules << " modules needs a radius of at least " << minRadius/mm << " mm";
+      G4Exception("DetectorConstruction::ModuleTransforms()", "Geom001", FatalException, ed);
+    }
+    for (G4int i=0; i<NModules; i++) {
+      G4double phi = i*twopi/NModules;
+      G4RotationMatrix rotation;
+      rotation.rotateY(90.*deg);
+      rotation.rotateZ(phi);
+      placements.push_back(G4Transform3D(rotation, G4ThreeVector(radius*std::cos(phi), radius*std::sin(phi), 0.)));
+    }
+    extent = radius + moduleDiagonal;
+    return placements;
+  }
+
+  if (NModules > 1 && Pitch < 2.*moduleR) {
+    G4ExceptionDescription ed;
+    ed << "Grid pitch " << Pitch/mm << " mm is below the module diameter " << 2.*moduleR/mm << " mm";
+    G4Exception("DetectorConstruction::ModuleTransforms()", "Geom002", FatalException, ed);
+  }
+  G4int columns = Columns > 0 ? Columns : G4int(std::ceil(std::sqrt(G4double(NModules))));
+  G4int rows = (NModules + columns - 1)/columns;
+  extent = moduleDiagonal;
+  for (G4int i=0; i<NModules; i++) {
+    G4double x = (i%columns - 0.5*(columns - 1))*Pitch;
+    G4double y = (i/columns - 0.5*(rows - 1))*Pitch;
+    placements.push_back(G4Transform3D(G4RotationMatrix(), G4ThreeVector(x, y, 0.)));
+    extent = std::max(extent, std::max(std::abs(x), std::abs(y)) + moduleDiagonal);
+  }
+  return placements;
+}
 
 G4VPhysicalVolume* DetectorConstruction::Construct()
 {
@@ -87,83 +165,17 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   //------------------------------------------------------
   // Optical properties
   //------------------------------------------------------
-  const G4int nEntries = 4;
-  G4double PhotonEnergy[nEntries] = {2.49*eV, 2.75*eV, 3.44*eV, 3.76*eV};
-  G4double MgORefractionIndex[nEntries] = {1.74, 1.75, 1.77, 1.78};
-  G4double MgOAbsorptionLength[nEntries] = {8.0*cm, 7.5*cm, 6.25*cm, 5.0*cm}; // From abs coeff 0.2 -> 0.05 cm-1
-
-  G4MaterialPropertiesTable* MgOMPT = new G4MaterialPropertiesTable();
-  MgOMPT->AddProperty("RINDEX", PhotonEnergy, MgORefractionIndex, nEntries);
-  MgOMPT->AddProperty("ABSLENGTH", PhotonEnergy, MgOAbsorptionLength, nEntries);
-  MgO->SetMaterialPropertiesTable(MgOMPT);
-
-  G4double LaBr3RefractionIndex[nEntries] = {2.1, 2.27, 2.3, 2.4}; // 10.1109/TNS.2012.2193597
-  G4double LaBr3AbsorptionLength[nEntries] = {19.*cm, 16.*cm, 10.*cm, 0.1*cm}; // 10.1109/TNS.2012.2193597
-  G4double ScintFast[nEntries] = {1.00, 1.00, 0.99, 0.97};
-
-  G4MaterialPropertiesTable* LaBr3MPT = new G4MaterialPropertiesTable();
-  LaBr3MPT->AddProperty("RINDEX", PhotonEnergy, LaBr3RefractionIndex, nEntries);
-  LaBr3MPT->AddProperty("ABSLENGTH", PhotonEnergy, LaBr3AbsorptionLength, nEntries);
-  LaBr3MPT->AddProperty("SCINTILLATIONCOMPONENT1", PhotonEnergy, ScintFast, nEntries);
-  LaBr3MPT->AddConstProperty("SCINTILLATIONYIELD", 73./keV);
-  LaBr3MPT->AddConstProperty("RESOLUTIONSCALE", 1.);
-  LaBr3MPT->AddConstProperty("SCINTILLATIONTIMECONSTANT1", 25.0*ns);
-  LaBr3MPT->AddConstProperty("SCINTILLATIONYIELD1", 1.);
-  LaBr3->SetMaterialPropertiesTable(LaBr3MPT);
-
-  G4double BGO_RI[nEntries] = {2.14, 2.17, 2.27, 2.33}; // 10.1364/AO.35.003562
-  G4double BGO_AL[nEntries] = {10.*cm, 8.5*cm, 7.8*cm, 3.0*cm};
-  G4double BGO_Fast[nEntries] = {1.00, 0.99, 0.97, 0.95};
-
-  G4MaterialPropertiesTable* BGO_MPT = new G4MaterialPropertiesTable();
-  BGO_MPT->AddProperty("RINDEX", PhotonEnergy, BGO_RI, nEntries);
-  BGO_MPT->AddProperty("ABSLENGTH", PhotonEnergy, BGO_AL, nEntries);
-  BGO_MPT->AddProperty("SCINTILLATIONCOMPONENT1", PhotonEnergy, BGO_Fast, nEntries);
-  BGO_MPT->AddConstProperty("SCINTILLATIONYIELD", 10.0/keV);
-  BGO_MPT->AddConstProperty("RESOLUTIONSCALE", 1.);
-  BGO_MPT->AddConstProperty("SCINTILLATIONTIMECONSTANT1", 20.*ns);
-  BGO_MPT->AddConstProperty("SCINTILLATIONYIELD1", 1.);
-  BGOmat->SetMaterialPropertiesTable(BGO_MPT);
-
-  G4double QuartzRefractionIndex[nEntries] = {1.462, 1.465, 1.47, 1.48}; //https://refractiveindex.info/?shelf=main&book=SiO2&page=Malitson
-  G4double QuartzAbsorptionLength[nEntries] = {1E7*cm, 1E7*cm, 1E7*cm, 1E7*cm};
-
-  G4MaterialPropertiesTable* QuartzMPT = new G4MaterialPropertiesTable();
-  QuartzMPT->AddProperty("RINDEX", PhotonEnergy, QuartzRefractionIndex, nEntries);
-  QuartzMPT->AddProperty("ABSLENGTH", PhotonEnergy, QuartzAbsorptionLength, nEntries);
-  Quartz->SetMaterialPropertiesTable(QuartzMPT);
-
-  G4double Optgrease_RI[nEntries] = {1.46, 1.46, 1.46, 1.46};
-  G4double Optgrease_AL[nEntries] = {400.0*cm, 400.0*cm, 400.0*cm, 400.0*cm};
-
-  G4MaterialPropertiesTable* Optgrease_MPT = new G4MaterialPropertiesTable();
-  Optgrease_MPT->AddProperty("RINDEX", PhotonEnergy, Optgrease_RI, nEntries);
-  Optgrease_MPT->AddProperty("ABSLENGTH", PhotonEnergy, Optgrease_AL, nEntries);
-  Optgrease->SetMaterialPropertiesTable(Optgrease_MPT);
-
-  G4double SiPM_RI[nEntries] = {4.32, 5.57, 6.5, 5.1};
-  G4double SiPM_AL[nEntries] = {0.000001*cm, 0.000001*cm, 0.000001*cm, 0.000001*cm};
-
-  G4MaterialPropertiesTable* SiPM_MPT = new G4MaterialPropertiesTable();
-  SiPM_MPT->AddProperty("RINDEX", PhotonEnergy, SiPM_RI, nEntries);
-  SiPM_MPT->AddProperty("ABSLENGTH", PhotonEnergy, SiPM_AL, nEntries);
-  Optmat->SetMaterialPropertiesTable(SiPM_MPT);
-
-  G4double vacRefractionIndex[nEntries] = {1.0, 1.0, 1.0, 1.0};
-
-  G4MaterialPropertiesTable* vacMPT = new G4MaterialPropertiesTable();
-  vacMPT->AddProperty("RINDEX",PhotonEnergy,vacRefractionIndex, nEntries);
-  vacuum->SetMaterialPropertiesTable(vacMPT);
+  MgO->SetMaterialPropertiesTable(opticalProperties->GetTable("MgO"));
+  LaBr3->SetMaterialPropertiesTable(opticalProperties->GetTable("LaBr3"));
+  BGOmat->SetMaterialPropertiesTable(opticalProperties->GetTable("BGO"));
+  Quartz->SetMaterialPropertiesTable(opticalProperties->GetTable("Quartz"));
+  Optgrease->SetMaterialPropertiesTable(opticalProperties->GetTable("Optical_grease"));
+  Optmat->SetMaterialPropertiesTable(opticalProperties->GetTable("SiPM"));
+  vacuum->SetMaterialPropertiesTable(opticalProperties->GetTable("Vacuum"));
 
 //------------------------------------------------------
 // Detector geometry
 //------------------------------------------------------
-  WorldSize = 30.*cm;
-
-  G4Box* solidWorld = new G4Box("World", WorldSize/2, WorldSize/2, WorldSize/2);
-  G4LogicalVolume* logicWorld = new G4LogicalVolume(solidWorld, vacuum, "World");
-  G4VPhysicalVolume* physiWorld = new G4PVPlacement(0, G4ThreeVector(), "World", logicWorld, NULL, false, 0);
-
 //Detector
 
   LaBr3Rmin = 0.00*cm;
@@ -198,27 +210,47 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   G4double BGOW_Y = 6.1*mm;
   G4double BGOW_Z = 60.1*mm;
 
+//Modules, each holding one detector with its SiPM plane and BGO ring
+
+  G4double ModuleR = 35.*mm;
+  G4double ModuleHalfZ = BGOW_Z/2 + 0.05*mm;
+  G4double extent = 0.;
+  std::vector<G4Transform3D> placements = ModuleTransforms(ModuleR, ModuleHalfZ, extent);
+
+  WorldSize = std::max(30.*cm, 2.*extent + 2.*cm);
+
+  G4Box* solidWorld = new G4Box("World", WorldSize/2, WorldSize/2, WorldSize/2);
+  G4LogicalVolume* logicWorld = new G4LogicalVolume(solidWorld, vacuum, "World");
+  G4VPhysicalVolume* physiWorld = new G4PVPlacement(0, G4ThreeVector(), "World", logicWorld, NULL, false, 0);
+
+  G4Tubs* solidModule = new G4Tubs("Module", 0., ModuleR, ModuleHalfZ, StartPhi, DeltaPhi);
+  G4LogicalVolume* lModule = new G4LogicalVolume(solidModule, vacuum, "Module");
+  G4VPhysicalVolume* physiModule = new G4PVPlacement(placements[0], lModule, "Module", logicWorld, false, 0);
+  for (G4int i=1; i<NModules; i++) {
+    new G4PVPlacement(placements[i], lModule, "Module", logicWorld, false, i);
+  }
+
 //Reflector
 
   G4Tubs* reflector_al = new G4Tubs("Reflector", Reflector_Rmin, Reflector_Rmax,Reflector_Z/2, StartPhi, DeltaPhi);
   G4LogicalVolume* lreflector_al = new G4LogicalVolume(reflector_al, Tefmat, "Reflector");
-  G4VPhysicalVolume* physireflector_al = new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, 0.*cm), "reflector", lreflector_al, physiWorld, false, 0);
+  G4VPhysicalVolume* physireflector_al = new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, 0.*cm), "reflector", lreflector_al, physiModule, false, 0);
 
   G4Tubs* reflector_alface = new G4Tubs("Reflectorface", 0.0*cm, Reflector_Rmax, (0.1*cm)/2, StartPhi, DeltaPhi);
   G4LogicalVolume* lreflector_alface = new G4LogicalVolume(reflector_alface, Tefmat, "Reflectorface");
   G4VPhysicalVolume* physireflector_alface = new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, -(Reflector_Z/2) + ((0.1*cm)/2)), "reflectorface",
-                                 lreflector_alface, physiWorld, false, 0);
+                                 lreflector_alface, physiModule, false, 0);
 
 //Housing
 
   G4Tubs* housing_al = new G4Tubs("housing", Alhos_Rmin, Alhos_Rmax, Alhos_Z/2, StartPhi, DeltaPhi);
   G4LogicalVolume* lhousing_al = new G4LogicalVolume(housing_al, AluR, "lhousing");
-  G4VPhysicalVolume* physihousing_al = new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, 0.*cm), "physichousing", lhousing_al, physiWorld, false, 0);
+  G4VPhysicalVolume* physihousing_al = new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, 0.*cm), "physichousing", lhousing_al, physiModule, false, 0);
 
   G4Tubs* housing_alface = new G4Tubs("housingface", 0.0*cm, Alhos_Rmax, (0.05*cm)/2, StartPhi, DeltaPhi);
   G4LogicalVolume* lhousing_alface = new G4LogicalVolume(housing_alface, AluR, "lhousingface");
   G4VPhysicalVolume* physihousing_alface = new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, -(Reflector_Z/2) + 0.1*cm + ((0.05*cm)/2)),
-                                 "reflectorface", lreflector_alface, physiWorld, false, 0);
+                                 "reflectorface", lreflector_alface, physiModule, false, 0);
 
 //LaBr3 crystal
 
@@ -226,27 +258,33 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   G4Tubs* SLaBr3 = new G4Tubs("LaBr3", LaBr3Rmin, LaBr3Rmax, LaBr3Z/2, StartPhi, DeltaPhi);
   G4LogicalVolume* lLaBr3 = new G4LogicalVolume(SLaBr3, LaBr3, "lLaBr3");
   G4VPhysicalVolume* physiLaBr3  = new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, -(Reflector_Z/2) + 0.05*cm + LaBr3Z/2), "Physi_LaBr3",
-                             lLaBr3, physiWorld, false, 0);
+                             lLaBr3, physiModule, false, 0);
 
 //Teflon
 
   G4Tubs* Teflon = new G4Tubs("Teflon", LaBr3Rmax, LaBr3Rmax + 0.05*cm, Reflector_Z/2, StartPhi, DeltaPhi);
   G4LogicalVolume* lteflon = new G4LogicalVolume(Teflon, Tefmat, "Teflon");
-  G4VPhysicalVolume* physitef = new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, 0.*cm), "teflon", lteflon, physiWorld, false, 0);
+  G4VPhysicalVolume* physitef = new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, 0.*cm), "teflon", lteflon, physiModule, false, 0);
 
 //Window
 
   G4Tubs* Glass_window = new G4Tubs("Glass_window", Glass_Rmin, Glass_Rmax, Glass_Z/2, StartPhi, DeltaPhi);
   G4LogicalVolume* lglassWindow = new G4LogicalVolume(Glass_window, Quartz, "Glass_window");
   G4VPhysicalVolume* physiglassWindow = new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, -(Reflector_Z/2) + 0.05*cm + LaBr3Z + (Glass_Z/2)),
-                              "Glass_window", lglassWindow, physiWorld, false, 0);
-
-//Optgel
-
-  G4Tubs* Optgel = new G4Tubs("optgel", LaBr3Rmin, LaBr3Rmax, LaBr3Z/1000, StartPhi, DeltaPhi);
-  G4LogicalVolume* lOptgel = new G4LogicalVolume(Optgel, Optgrease, "optgel");
-  G4VPhysicalVolume* physiOptgel = new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, -(Reflector_Z/2) + 0.05*cm + LaBr3Z + (Glass_Z) + (LaBr3Z/1000)),
-                             "optgel", lOptgel, physiWorld, false, 0);
+                              "Glass_window", lglassWindow, physiModule, false, 0);
+
+//Optgel (with the coated coupling the SiPMs sit directly on the window)
+
+  CouplingThickness = 2*LaBr3Z/1000;
+  G4double SiPMGap = CouplingThickness;
+  if (CouplingModel == "volume") {
+    G4Tubs* Optgel = new G4Tubs("optgel", LaBr3Rmin, LaBr3Rmax, LaBr3Z/1000, StartPhi, DeltaPhi);
+    G4LogicalVolume* lOptgel = new G4LogicalVolume(Optgel, Optgrease, "optgel");
+    new G4PVPlacement(0, G4ThreeVector(0.*cm, 0.*cm, -(Reflector_Z/2) + 0.05*cm + LaBr3Z + (Glass_Z) + (LaBr3Z/1000)),
+                      "optgel", lOptgel, physiModule, false, 0);
+  } else {
+    SiPMGap = 0.;
+  }
 
 //SiPm positions
 
@@ -308,8 +346,8 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   G4VPhysicalVolume* physiSiPM[52];
 
   for(G4int i=0; i<52; i++) {
-    new G4PVPlacement(0, G4ThreeVector(SP_X[i], SP_Y[i], -(Reflector_Z/2) + 0.05*cm + LaBr3Z + (Glass_Z) + (2*LaBr3Z/1000) + (SiPM_Z/2)),
-              "Physi_SiPM", lSipm, physiWorld, true, i);
+    physiSiPM[i] = new G4PVPlacement(0, G4ThreeVector(SP_X[i], SP_Y[i], -(Reflector_Z/2) + 0.05*cm + LaBr3Z + (Glass_Z) + SiPMGap + (SiPM_Z/2)),
+                                     "Physi_SiPM", lSipm, physiModule, true, i);
   }
 
 
@@ -323,9 +361,9 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
     G4RotationMatrix* rotationMatrix = new G4RotationMatrix();
     rotationMatrix->rotateZ((j)*12.857*deg);
     physiBGOW = new G4PVPlacement(rotationMatrix, G4ThreeVector(std::sin((j)*12.857*deg)*31.25*mm, std::cos((j)*12.857*deg)*31.25*mm, 0.*cm),
-                    "BGOW", lBGOW, physiWorld, false, j);
+                    "BGOW", lBGOW, physiModule, false, j);
     // new G4PVPlacement(rotationMatrix, G4ThreeVector(std::sin((j)*12.857*deg)*31.25*mm, std::cos((j)*12.857*deg)*31.25*mm, BGOW_Z/2 + SiPM_Z/2),
-    //                       "BGO_SiPM", lSipm, physiWorld, false, 100+j); //za BGO            
+    //                       "BGO_SiPM", lSipm, physiModule, false, 100+j); //za BGO            
   }       
   new G4PVPlacement(0, G4ThreeVector(0,0, BGOW_Z/2 - SiPM_Z/2),
                           "BGO_SiPM", lSipm, physiBGOW, false, 100);
@@ -349,14 +387,7 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   OpRefCrySurface->SetFinish(groundfrontpainted);
   G4LogicalBorderSurface* RefCrySurface = new G4LogicalBorderSurface("LaBr3_tef",physiLaBr3,physitef,OpRefCrySurface);
 
-  G4double energy[2] = {3.0995*eV, 4.9592*eV};
-  G4double rindex_teflon[2] = {1.3570, 1.4530};
-  G4double reflectivity[2] = {0.90, 0.90};
-
-  G4MaterialPropertiesTable* SMPT = new G4MaterialPropertiesTable();
-  SMPT->AddProperty("RINDEX", energy, rindex_teflon, 2);
-  SMPT->AddProperty("REFLECTIVITY", energy, reflectivity, 2);
-  OpRefCrySurface->SetMaterialPropertiesTable(SMPT);
+  OpRefCrySurface->SetMaterialPropertiesTable(opticalProperties->GetTable("LaBr3_tef"));
 
   G4OpticalSurface* faceLaBr = new G4OpticalSurface("LaBr3_Al");
   faceLaBr->SetType(dielectric_metal);
@@ -366,24 +397,56 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   BGOAL->SetType(dielectric_metal);
   BGOAL->SetModel(unified);
   BGOAL->SetFinish(groundfrontpainted);
-  G4double reflectivity_metal[2] = {0.95, 0.95}; // np. 95% odbicia
-  G4double efficiency_metal[2] = {0.0, 0.0};     // 0 = nie jest detektorem
-  G4MaterialPropertiesTable* metalMPT = new G4MaterialPropertiesTable();
-  metalMPT->AddProperty("REFLECTIVITY", energy, reflectivity_metal, 2);
-  metalMPT->AddProperty("EFFICIENCY", energy, efficiency_metal, 2);
-  BGOAL->SetMaterialPropertiesTable(metalMPT);
+  BGOAL->SetMaterialPropertiesTable(opticalProperties->GetTable("BGO_Al"));
   new G4LogicalSkinSurface("BGO_Al", lBGO, BGOAL);
 
   // // BGOAL->SetModel(unified);
   // // BGOAL->SetFinish(groundfrontpainted);
   // G4LogicalBorderSurface* BGOALSurface = new G4LogicalBorderSurface("BGO_Al",physiBGO,physiBGOW,BGOAL);
-  // BGOAL->SetMaterialPropertiesTable(SMPT);
+  // BGOAL->SetMaterialPropertiesTable(opticalProperties->GetTable("LaBr3_tef"));
+
+// Window - SiPM coupling as a thin grease film (/LaBr/coupling/model coated)
+
+  if (CouplingModel == "coated") {
+#if G4VERSION_NUMBER >= 1110
+    G4MaterialPropertiesTable* couplingTable = opticalProperties->GetTable("Grease_coating");
+    couplingTable->AddConstProperty("COATEDTHICKNESS", CouplingThickness);
+    G4OpticalSurface* OpCoupling = new G4OpticalSurface("Grease_coating");
+    OpCoupling->SetType(coated);
+    OpCoupling->SetModel(unified);
+    OpCoupling->SetFinish(polished);
+    OpCoupling->SetMaterialPropertiesTable(couplingTable);
+    for (G4int i=0; i<52; i++) {
+      new G4LogicalBorderSurface("Grease_coating", physiglassWindow, physiSiPM[i], OpCoupling);
+    }
+#else
+    G4Exception("DetectorConstruction::Construct()", "Geom003", JustWarning,
+                "Coated surfaces need Geant4 11.1 or newer; the window is coupled directly to the SiPMs");
+#endif
+  }
+
+//------------------------------------------------------
+// Regions, with their own production cuts (PhysicsList)
+//------------------------------------------------------
+
+  G4Region* LaBr3Region = new G4Region("LaBr3Region");
+  LaBr3Region->AddRootLogicalVolume(lLaBr3);
+
+  G4Region* BGORegion = new G4Region("BGORegion");
+  BGORegion->AddRootLogicalVolume(lBGOW);
+
+  G4Region* PassiveRegion = new G4Region("PassiveRegion");
+  PassiveRegion->AddRootLogicalVolume(lreflector_al);
+  PassiveRegion->AddRootLogicalVolume(lreflector_alface);
+  PassiveRegion->AddRootLogicalVolume(lteflon);
+  PassiveRegion->AddRootLogicalVolume(lhousing_al);
 
 //------------------------------------------------------
 // visualization attributes
 //------------------------------------------------------
 
   logicWorld->SetVisAttributes(G4VisAttributes::GetInvisible());
+  lModule->SetVisAttributes(G4VisAttributes::GetInvisible());
 
   G4VisAttributes* Att1= new G4VisAttributes(G4Colour(0.0, 1.0, 0.0));
   lLaBr3->SetVisAttributes(Att1);
@@ -395,5 +458,7 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   G4VisAttributes* Att4= new G4VisAttributes(G4Colour(1.0, 0.0, 1.0));
   lSipm->SetVisAttributes(Att4);
 
+  opticalProperties->Report();
+
   return physiWorld;
 }
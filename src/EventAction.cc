@@ -1,35 +1,310 @@
 #include "PrimaryGeneratorAction.hh"
+#include "ConvergenceMonitor.hh"
 #include "EventAction.hh"
+#include "Checkpoint.hh"
+#include "SubEventPool.hh"
+#include "StackingAction.hh"
+#include "EventExporter.hh"
+#include "BGOVeto.hh"
+#include "PhotonTiming.hh"
+#include "MemoryUsage.hh"
+#include "HistoManager.hh"
 #include "RunAction.hh"
 #include "Analysis.hh"
 
 #include "G4GeneralParticleSource.hh"
+#include "G4GenericMessenger.hh"
+#include "G4OpticalParameters.hh"
 #include "G4EventManager.hh"
 #include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
 #include "G4UnitsTable.hh"
 #include "G4Event.hh"
+#include "Randomize.hh"
 #include "globals.hh"
 
+#include <algorithm>
+#include <cfloat>
 #include <iomanip>
 
 using namespace std;
 using namespace CLHEP;
 
-EventAction::EventAction(G4int *evN) : G4UserEventAction(), PrintModulo(10000)
+EventAction::EventAction(G4int *evN, RunAction* runAct, G4String nameAdd)
+  : G4UserEventAction(), PrintModulo(10000), treeBufferBytes(0), runAction(runAct), checkpoint(nullptr),
+    subEventPool(nullptr), stackingAction(nullptr), eventOffset(0), writeEventTree(true), fileOutName("Events_" + nameAdd + ".root"),
+    efficiency(kNSiPM, 0.), ListMode(nullptr), fileOut(nullptr)
 {
  evNr=evN;          
+
+  messenger = new G4GenericMessenger(this, "/LaBr/output/", "Output control");
+  messenger->DeclareProperty("eventTree", writeEventTree, "Write one row per event (tree E in Events_*.root)");
+  messenger->DeclareProperty("printEvery", PrintModulo, "Events between progress lines (with memory usage)")
+    .SetRange("printEvery>0");
+
+  exporter = new EventExporter(kNSiPM + kNBGO);
+  timing = runAction->GetPhotonTiming();
+  veto = new BGOVeto();
+
+  yieldMessenger = new G4GenericMessenger(this, "/LaBr/yield/", "Photon yield mode (/LaBr/phys/yieldOnly)");
+  yieldMessenger->DeclareMethod("efficiency", &EventAction::SetUniformEfficiency,
+                                "Probability that a LaBr3 photon is counted, the same for every SiPM")
+    .SetParameterName("efficiency", false)
+    .SetRange("efficiency>=0 && efficiency<=1");
+  yieldMessenger->DeclareMethod("efficiencyFile", &EventAction::SetEfficiencyFile,
+                                "File with one efficiency per SiPM channel");
 }
 
 EventAction::~EventAction()
-{}
+{
+  delete veto;
+  delete exporter;
+  delete yieldMessenger;
+  delete messenger;
+  if (!fileOut) return;
+  fileOut->cd();
+  ListMode->Write();
+  fileOut->Close();
+  G4cout << "Event tree written to " << fileOutName << G4endl;
+}
+
+void EventAction::SetBranchListMode()
+{
+  fileOut = new TFile(fileOutName.c_str(), "RECREATE");
+  ListMode = new TTree("E", "Per-event energy deposits");
+  AttachBranches(true);
+}
+
+void EventAction::AttachBranches(G4bool create)
+{
+  auto attach = [this, create](const char* name, void* address, const char* leaves) {
+    if (create) ListMode->Branch(name, address, leaves);
+    else ListMode->SetBranchAddress(name, address);
+  };
+  attach("evNr", &eventNr, "evNr/I");
+  attach("Edep", Edep, Form("Edep[%d]/D", kNEdepSlots));
+  attach("Visible", Visible, Form("Visible[%d]/D", kNEdepSlots));
+  attach("Yield", Yield, Form("Yield[%d]/D", kNEdepSlots));
+  attach("Expected", Expected, Form("Expected[%d]/D", kNSiPM));
+  attach("nPhotons", &nPhotonsTotal, "nPhotons/I");
+  attach("weight", &eventWeight, "weight/D");
+  attach("Vetoed", &vetoFlag, "Vetoed/I");
+
+  // Timing estimators (/LaBr/timing/kPhoton) replace the per-photon Gtime rows
+  if (timing->IsActive()) {
+    attach("FirstTime", timing->GetFirstTimes(), Form("FirstTime[%d]/D", kNSiPM));
+    attach("KthTime", timing->GetKthTimes(), Form("KthTime[%d]/D", kNSiPM));
+    attach("MeanKTime", timing->GetMeanTimes(), Form("MeanKTime[%d]/D", kNSiPM));
+    attach("ArrayTime", timing->GetArrayTimeAddress(), "ArrayTime/D");
+  }
+}
+
+Long64_t EventAction::SaveCheckpoint()
+{
+  if (!fileOut) return 0;
+  ListMode->AutoSave("SaveSelf FlushBaskets");
+  return ListMode->GetEntries();
+}
+
+G4bool EventAction::ResumeOutput(const G4String& fileName, Long64_t entries)
+{
+  TFile* file = new TFile(fileName.c_str(), "UPDATE");
+  TTree* tree = nullptr;
+  if (!file->IsZombie()) file->GetObject("E", tree);
+  if (!tree || tree->GetEntries() != entries) {
+    delete file;
+    return false;
+  }
+
+  delete fileOut;
+  fileOut = file;
+  ListMode = tree;
+  fileOutName = fileName;
+  AttachBranches(false);
+  return true;
+}
 
 void EventAction::BeginOfEventAction(const G4Event* evt)
 {
-  G4int eventID = evt->GetEventID();
+  // Continues the numbering of a resumed checkpoint (/LaBr/checkpoint/resume)
+  G4int eventID = evt->GetEventID() + eventOffset;
   *evNr = eventID;
-  if (eventID %  PrintModulo == 0)
-    G4cout << "\n---> Begin of Event: " << eventID << G4endl;
+  if (eventID %  PrintModulo == 0) {
+    MemoryUsage memory = MemoryUsage::Read();
+    G4cout << "\n---> Begin of Event: " << eventID << "   RSS " << memory.rss << " MB (peak " << memory.peakRss
+           << " MB), step tree baskets " << treeBufferBytes/1024. << " kB" << G4endl;
+  }
+
+  std::fill(Edep, Edep + kNEdepSlots, 0.);
+  std::fill(Visible, Visible + kNEdepSlots, 0.);
+  std::fill(Yield, Yield + kNEdepSlots, 0.);
+  EdepWeighted = 0.;
+  EdepPosition = G4ThreeVector();
+  std::fill(SiPMPhotons, SiPMPhotons + kNSiPM, 0);
+  std::fill(BGOPhotons, BGOPhotons + kNBGO, 0);
+  FirstPhotonTime = DBL_MAX;
+  timing->Clear();
+  veto->Clear();
+  exporter->BeginEvent();
+  if (subEventPool) subEventPool->Clear();
+  nDecays = 0;
+  LastDecayTime = 0.;
 }
 
 void EventAction::EndOfEventAction(const G4Event* evt)
-{}
+{
+  veto->EndOfEvent();
+
+  // Rejected by the event filter (StackingAction) or dropped by the BGO veto;
+  // the filter decides here on events without optical photons.
+  // The LaBr3 photons of the sub-event mode are tracked before the outputs,
+  // and the watchdog may still abort the event there
+  if (!evt->IsAborted() && (!stackingAction || stackingAction->AcceptEvent())
+      && (!subEventPool || subEventPool->Process())) {
+    FillEvent();
+  }
+
+  // Last, so the saved engine state is the one the next event starts from
+  if (checkpoint) checkpoint->EndOfEvent(*evNr);
+}
+
+void EventAction::FillEvent()
+{
+  G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+
+  G4double edepBGO = 0.;
+  for (G4int i=kSlotBGO; i<kSlotBGO + kNBGO; i++) edepBGO += Edep[i];
+  G4double edepTotal = 0.;
+  for (G4int i=0; i<kNEdepSlots; i++) edepTotal += Edep[i];
+
+  // With biased decays the tracks of one event can carry different weights;
+  // event-level spectra use the energy-weighted mean track weight.
+  G4double weight = edepTotal > 0. ? EdepWeighted/edepTotal : 1.;
+
+  if (Edep[kSlotLaBr3] > 0.) analysisManager->FillH1(HistoManager::kEdepLaBr3, Edep[kSlotLaBr3], weight);
+  if (edepBGO > 0.) analysisManager->FillH1(HistoManager::kEdepBGO, edepBGO, weight);
+  if (Edep[kSlotLaBr3] > 0. && !veto->IsVetoed()) {
+    analysisManager->FillH1(HistoManager::kEdepLaBr3Suppressed, Edep[kSlotLaBr3], weight);
+  }
+
+  for (G4int i=0; i<kNSiPM; i++) {
+    Expected[i] = Yield[kSlotLaBr3]*efficiency[i];
+  }
+
+  // Without tracked optical photons the SiPM counts are sampled from the
+  // expected numbers, so the photon spectra keep their statistics.
+  if (!G4OpticalParameters::Instance()->GetScintStackPhotons()) {
+    for (G4int i=0; i<kNSiPM; i++) {
+      SiPMPhotons[i] = Expected[i] > 0. ? CLHEP::RandPoisson::shoot(Expected[i]) : 0;
+    }
+  }
+
+  G4int nPhotons = 0;
+  for (G4int i=0; i<kNSiPM; i++) {
+    if (SiPMPhotons[i] == 0) continue;
+    analysisManager->FillH1(HistoManager::kSiPMPhotons, i, SiPMPhotons[i]);
+    nPhotons += SiPMPhotons[i];
+  }
+  if (nPhotons > 0) {
+    analysisManager->FillH1(HistoManager::kPhotonsPerEvent, nPhotons, weight);
+    if (FirstPhotonTime < DBL_MAX) analysisManager->FillH1(HistoManager::kFirstPhotonTime, FirstPhotonTime, weight);
+  }
+  for (G4int i=0; i<kNBGO; i++) {
+    if (BGOPhotons[i] > 0) analysisManager->FillH1(HistoManager::kBGOPhotons, i, BGOPhotons[i]);
+  }
+
+  if (nDecays > 0) {
+    analysisManager->FillH1(HistoManager::kDecayChainTime, LastDecayTime, weight);
+    analysisManager->FillH1(HistoManager::kDecayVisibleEnergy, edepTotal, weight);
+  }
+
+  runAction->GetConvergenceMonitor()->AddEvent(Edep[kSlotLaBr3], nPhotons);
+
+  if (timing->IsActive()) {
+    timing->EndOfEvent(Edep[kSlotLaBr3]);
+    if (timing->GetArrayTime() >= 0.) analysisManager->FillH1(HistoManager::kArrayTime, timing->GetArrayTime(), weight);
+  }
+
+  if (exporter->IsActive()) {
+    float counts[kNSiPM + kNBGO];
+    for (G4int i=0; i<kNSiPM; i++) counts[i] = SiPMPhotons[i];
+    for (G4int i=0; i<kNBGO; i++) counts[kNSiPM + i] = BGOPhotons[i];
+    G4ThreeVector pos = Edep[kSlotLaBr3] > 0. ? EdepPosition/Edep[kSlotLaBr3] : G4ThreeVector();
+    float truth[EventExporter::kNTruth] = {float(pos.x()/mm), float(pos.y()/mm), float(pos.z()/mm),
+                                           float(Edep[kSlotLaBr3]/MeV), float(Visible[kSlotLaBr3]/MeV),
+                                           float(edepBGO/MeV), float(weight)};
+    exporter->Fill(*evNr, counts, truth);
+  }
+
+  if (writeEventTree && edepTotal > 0.) {
+    if (!fileOut) SetBranchListMode();
+    eventNr = *evNr;
+    nPhotonsTotal = nPhotons;
+    eventWeight = weight;
+    vetoFlag = veto->IsVetoed();
+    ListMode->Fill();
+  }
+}
+
+void EventAction::AddEdep(G4int slot, G4double edep, G4double visible, G4double weight)
+{
+  Edep[slot] += edep;
+  Visible[slot] += visible;
+  EdepWeighted += weight*edep;
+}
+
+void EventAction::AddSiPMPhoton(G4int channel, G4double time)
+{
+  SiPMPhotons[channel]++;
+  if (time < FirstPhotonTime) FirstPhotonTime = time;
+  if (timing->IsActive()) timing->AddPhoton(channel, time);
+  if (exporter->WantsTimes()) exporter->AddPhotonTime(channel, time);
+}
+
+G4bool EventAction::IsVetoed() const
+{
+  return veto->IsVetoed();
+}
+
+void EventAction::AddBGOPhoton(G4int bar, G4double time)
+{
+  BGOPhotons[bar]++;
+  if (veto->AddPhoton(time) && veto->DropsEvents()) {
+    G4EventManager::GetEventManager()->AbortCurrentEvent();
+  }
+  if (exporter->WantsTimes()) exporter->AddPhotonTime(kNSiPM + bar, time);
+}
+
+void EventAction::AddDecay(G4double q, G4double time, G4double weight)
+{
+  G4AnalysisManager::Instance()->FillH1(HistoManager::kDecayQ, q, weight);
+  nDecays++;
+  if (time > LastDecayTime) LastDecayTime = time;
+}
+
+void EventAction::SetUniformEfficiency(G4double eff)
+{
+  std::fill(efficiency.begin(), efficiency.end(), eff);
+}
+
+void EventAction::SetEfficiencyFile(G4String fileName)
+{
+  std::ifstream in(fileName);
+  if (!in) {
+    G4ExceptionDescription ed;
+    ed << "Cannot open SiPM efficiency file " << fileName;
+    G4Exception("EventAction::SetEfficiencyFile()", "Event001", JustWarning, ed);
+    return;
+  }
+
+  G4int n = 0;
+  G4double eff;
+  while (n < kNSiPM && in >> eff) {
+    efficiency[n++] = eff;
+  }
+  if (n != kNSiPM) {
+    G4ExceptionDescription ed;
+    ed << fileName << " holds " << n << " efficiencies, " << kNSiPM << " expected; the rest keep their old value";
+    G4Exception("EventAction::SetEfficiencyFile()", "Event002", JustWarning, ed);
+  }
+}
@@ -0,0 +1,150 @@
+#include "EventExporter.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+  // Magic (6) + version (2) + header length (2) + header text
+  const std::size_t kHeaderSize = 128;
+}
+
+EventExporter::EventExporter(G4int nCh)
+  : prefix(""), nChannels(nCh), eventsPerShard(100000), timeBins(0), timeBinWidth(1.*ns),
+    shard(0), shardOpen(false)
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/export/", "Per-event arrays for training (.npy shards)");
+  messenger->DeclareMethod("file", &EventExporter::SetPrefix, "Prefix of the shard files (enables the export)");
+  messenger->DeclareProperty("eventsPerShard", eventsPerShard, "Number of events per shard")
+    .SetRange("eventsPerShard>0");
+  messenger->DeclareProperty("timeBins", timeBins, "Time bins per channel, 0 = no time array (set before the first event)")
+    .SetRange("timeBins>=0");
+  messenger->DeclarePropertyWithUnit("timeBinWidth", "ns", timeBinWidth, "Width of one time bin");
+}
+
+EventExporter::~EventExporter()
+{
+  Close();
+  delete messenger;
+}
+
+void EventExporter::SetPrefix(G4String name)
+{
+  Close();
+  prefix = name;
+  shard = 0;
+}
+
+// The time row is collected independently of the shard, which is only
+// opened when the first event of it is written.
+void EventExporter::BeginEvent()
+{
+  if (IsActive() && WantsTimes()) timeRow.assign(nChannels*timeBins, 0.f);
+}
+
+void EventExporter::AddPhotonTime(G4int channel, G4double time)
+{
+  if (timeRow.size() != std::size_t(nChannels*timeBins)) return;
+  G4int bin = G4int(time/timeBinWidth);
+  if (bin < 0 || bin >= timeBins) return;
+  timeRow[channel*timeBins + bin] += 1.f;
+}
+
+void EventExporter::Fill(G4int eventID, const float* counts, const float* truth)
+{
+  if (!shardOpen) OpenShard();
+
+  countsFile.out.write(reinterpret_cast<const char*>(counts), nChannels*sizeof(float));
+  countsFile.nRows++;
+  truthFile.out.write(reinterpret_cast<const char*>(truth), kNTruth*sizeof(float));
+  truthFile.nRows++;
+  std::int64_t id = eventID;
+  eventFile.out.write(reinterpret_cast<const char*>(&id), sizeof(id));
+  eventFile.nRows++;
+  if (timeBins > 0) {
+    timeRow.resize(nChannels*timeBins, 0.f);
+    timesFile.out.write(reinterpret_cast<const char*>(timeRow.data()), timeRow.size()*sizeof(float));
+    timesFile.nRows++;
+    std::fill(timeRow.begin(), timeRow.end(), 0.f);
+  }
+
+  if (countsFile.nRows >= eventsPerShard) {
+    CloseShard();
+  }
+}
+
+void EventExporter::Close()
+{
+  if (shardOpen) CloseShard();
+}
+
+void EventExporter::OpenShard()
+{
+  Open(countsFile, "counts", "<f4", {nChannels});
+  Open(truthFile, "truth", "<f4", {kNTruth});
+  Open(eventFile, "event", "<i8", {});
+  if (timeBins > 0) {
+    Open(timesFile, "times", "<f4", {nChannels, timeBins});
+  }
+  shardOpen = true;
+}
+
+void EventExporter::CloseShard()
+{
+  Finish(countsFile, "<f4");
+  Finish(truthFile, "<f4");
+  Finish(eventFile, "<i8");
+  if (timesFile.out.is_open()) Finish(timesFile, "<f4");
+  G4cout << "EventExporter: shard " << shard << " of " << prefix << " closed with " << countsFile.nRows << " events" << G4endl;
+  shardOpen = false;
+  shard++;
+}
+
+void EventExporter::Open(NpyFile& file, const G4String& array, const char* descr, const std::vector<G4int>& rowShape)
+{
+  std::ostringstream name;
+  name << prefix << "_" << array << "_" << std::setw(4) << std::setfill('0') << shard << ".npy";
+  file.out.open(name.str(), std::ios::binary | std::ios::trunc);
+  if (!file.out) {
+    G4ExceptionDescription ed;
+    ed << "Cannot create export file " << name.str();
+    G4Exception("EventExporter::Open()", "Export001", FatalException, ed);
+    return;
+  }
+  file.rowShape = rowShape;
+  file.nRows = 0;
+  // The number of rows is not known yet; the header is rewritten on close
+  file.out << Header(descr, 0, rowShape);
+}
+
+void EventExporter::Finish(NpyFile& file, const char* descr)
+{
+  file.out.seekp(0);
+  file.out << Header(descr, file.nRows, file.rowShape);
+  file.out.close();
+}
+
+std::string EventExporter::Header(const char* descr, std::int64_t nRows, const std::vector<G4int>& rowShape)
+{
+  std::ostringstream dict;
+  dict << "{'descr': '" << descr << "', 'fortran_order': False, 'shape': (" << nRows << ",";
+  for (std::size_t i=0; i<rowShape.size(); i++) {
+    dict << (i ? ", " : " ") << rowShape[i];
+  }
+  dict << "), }";
+
+  std::string text = dict.str();
+  std::size_t textSize = kHeaderSize - 10;
+  text.resize(std::max(text.size() + 1, textSize), ' ');
+  text.back() = '\n';
+
+  std::string header("\x93NUMPY\x01\x00", 8);
+  header += char(text.size() & 0xff);
+  header += char((text.size() >> 8) & 0xff);
+  return header + text;
+}
@@ -1,8 +1,9 @@
 #include "HistoManager.hh"
 
+#include "G4SystemOfUnits.hh"
 #include "G4UnitsTable.hh"
 
-HistoManager::HistoManager() : fFileName("rdecay01")
+HistoManager::HistoManager(const G4String& fileName) : fFileName(fileName)
 {
   Book();
 }
@@ -10,34 +11,29 @@ HistoManager::HistoManager() : fFileName("rdecay01")
 HistoManager::~HistoManager()
 {}
 
+G4String HistoManager::GetFileName(G4int runID) const
+{
+  return fFileName + "_run" + std::to_string(runID) + ".root";
+}
+
 void HistoManager::Book()
 {
   G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
-  analysisManager->SetFileName(fFileName);
+  analysisManager->SetDefaultFileType("root");
+  analysisManager->SetFileName(GetFileName(0));
   analysisManager->SetVerboseLevel(1);
   analysisManager->SetActivation(true);
 
-  const G4int kMaxHisto = 10;
-  const G4String id[] = {"0","1","2","3","4","5","6","7","8","9"};
-  const G4String title[] = 
-          { "dummy",                                    //0
-            "energy spectrum (%): e+ e-",               //1
-            "energy spectrum (%): nu_e anti_nu_e",      //2
-            "energy spectrum (%): gamma",               //3
-            "energy spectrum (%): alpha",               //4
-            "energy spectrum (%): ions",                //5
-            "total kinetic energy per single decay (Q)",//6
-            "momentum balance",                         //7
-            "total time of life of decay chain",        //8
-            "total visible energy in decay chain"       //9
-          };
-
-  G4int nbins = 100;
-  G4double vmin = 0.;
-  G4double vmax = 100.;
-
-  for (G4int k=0; k<kMaxHisto; k++) {
-    G4int ih = analysisManager->CreateH1(id[k], title[k], nbins, vmin, vmax);
-    analysisManager->SetH1Activation(ih, false);
-  }
+  analysisManager->CreateH1("EdepLaBr3", "energy deposit in LaBr3", 3000, 0., 3.*MeV, "keV");
+  analysisManager->CreateH1("EdepBGO", "energy deposit in the BGO ring", 3000, 0., 3.*MeV, "keV");
+  analysisManager->CreateH1("SiPMPhotons", "detected photons per LaBr3 SiPM channel", 52, -0.5, 51.5);
+  analysisManager->CreateH1("PhotonsPerEvent", "detected photons per event in LaBr3 SiPMs", 1000, 0., 100000.);
+  analysisManager->CreateH1("BGOPhotons", "detected photons per BGO SiPM channel", 28, -0.5, 27.5);
+  analysisManager->CreateH1("FirstPhotonTime", "first photon arrival time in LaBr3 SiPMs", 500, 0., 50.*ns, "ns");
+  analysisManager->CreateH1("DecayQ", "total kinetic energy per single decay (Q)", 1000, 0., 5.*MeV, "keV");
+  analysisManager->CreateH1("DecayChainTime", "total time of life of decay chain", 300, 1.*ns, 1.e21*s, "s", "log10");
+  analysisManager->CreateH1("DecayVisibleEnergy", "total visible energy in decay chain", 3000, 0., 3.*MeV, "keV");
+  // Booked in HistoId order, the IDs are the booking order
+  analysisManager->CreateH1("ArrayTime", "array timestamp (k-th photon of all LaBr3 SiPMs)", 2000, 0., 20.*ns, "ns");
+  analysisManager->CreateH1("EdepLaBr3Suppressed", "energy deposit in LaBr3 without BGO veto", 3000, 0., 3.*MeV, "keV");
 }
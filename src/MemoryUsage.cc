@@ -0,0 +1,21 @@
+#include "MemoryUsage.hh"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+MemoryUsage MemoryUsage::Read()
+{
+  MemoryUsage usage;
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    std::istringstream fields(line);
+    std::string key;
+    G4double kB = 0.;
+    fields >> key >> kB;
+    if (key == "VmRSS:") usage.rss = kB/1024.;
+    if (key == "VmHWM:") usage.peakRss = kB/1024.;
+  }
+  return usage;
+}
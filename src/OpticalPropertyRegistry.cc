@@ -0,0 +1,170 @@
+#include "OpticalPropertyRegistry.hh"
+
+#include "G4MaterialPropertiesTable.hh"
+#include "G4GenericMessenger.hh"
+#include "G4UnitsTable.hh"
+#include "G4Version.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+OpticalPropertyRegistry::OpticalPropertyRegistry()
+  : dataDir("data"), nBins(256), nRequested(0)
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/materials/", "Optical property data");
+  messenger->DeclareProperty("dataDir", dataDir, "Directory with the .mpt optical property files")
+    .SetStates(G4State_PreInit);
+  messenger->DeclareProperty("bins", nBins, "Minimum number of uniform energy bins of a resampled spectrum")
+    .SetRange("bins>=2")
+    .SetStates(G4State_PreInit);
+}
+
+OpticalPropertyRegistry::~OpticalPropertyRegistry()
+{
+  delete messenger;
+}
+
+G4MaterialPropertiesTable* OpticalPropertyRegistry::GetTable(const G4String& name)
+{
+  auto it = tables.find(name);
+  if (it != tables.end()) return it->second;
+
+  G4MaterialPropertiesTable* table = Load(name);
+  tables[name] = table;
+  return table;
+}
+
+G4MaterialPropertiesTable* OpticalPropertyRegistry::Load(const G4String& name)
+{
+  G4String fileName = dataDir + "/" + name + ".mpt";
+  std::ifstream in(fileName);
+  if (!in) {
+    G4ExceptionDescription ed;
+    ed << "Cannot open optical property file " << fileName << " (set the directory with /LaBr/materials/dataDir)";
+    G4Exception("OpticalPropertyRegistry::Load()", "OptProp001", FatalException, ed);
+    return nullptr;
+  }
+
+  G4MaterialPropertiesTable* table = new G4MaterialPropertiesTable();
+  std::string line;
+  G4int lineNr = 0;
+  while (std::getline(in, line)) {
+    lineNr++;
+    std::istringstream words(line);
+    std::string keyword;
+    if (!(words >> keyword) || keyword[0] == '#') continue;
+
+    if (keyword == "const") {
+      std::string key, unit;
+      G4double value;
+      if (!(words >> key >> value >> unit)) {
+        G4ExceptionDescription ed;
+        ed << fileName << ":" << lineNr << ": expected 'const KEY value unit'";
+        G4Exception("OpticalPropertyRegistry::Load()", "OptProp002", FatalException, ed);
+        continue;
+      }
+      table->AddConstProperty(key, value*ParseUnit(unit, fileName), true);
+    } else if (keyword == "property") {
+      std::string key, energyUnit, valueUnit;
+      if (!(words >> key >> energyUnit >> valueUnit)) {
+        G4ExceptionDescription ed;
+        ed << fileName << ":" << lineNr << ": expected 'property KEY energyUnit valueUnit'";
+        G4Exception("OpticalPropertyRegistry::Load()", "OptProp002", FatalException, ed);
+        continue;
+      }
+      G4double eScale = ParseUnit(energyUnit, fileName);
+      G4double vScale = ParseUnit(valueUnit, fileName);
+
+      std::vector<G4double> energy, value;
+      while (std::getline(in, line)) {
+        lineNr++;
+        std::istringstream point(line);
+        G4double e, v;
+        std::string first;
+        if (!(point >> first) || first[0] == '#') continue;
+        if (first == "end") break;
+        std::istringstream number(line);
+        if (!(number >> e >> v)) {
+          G4ExceptionDescription ed;
+          ed << fileName << ":" << lineNr << ": bad data point in " << key;
+          G4Exception("OpticalPropertyRegistry::Load()", "OptProp002", FatalException, ed);
+          continue;
+        }
+        energy.push_back(e*eScale);
+        value.push_back(v*vScale);
+      }
+      if (energy.size() < 2 || !std::is_sorted(energy.begin(), energy.end())) {
+        G4ExceptionDescription ed;
+        ed << fileName << ": " << key << " needs at least two points in increasing energy";
+        G4Exception("OpticalPropertyRegistry::Load()", "OptProp003", FatalException, ed);
+        continue;
+      }
+      table->AddProperty(key, MakeVector(energy, value), true);
+    } else {
+      G4ExceptionDescription ed;
+      ed << fileName << ":" << lineNr << ": unknown keyword " << keyword;
+      G4Exception("OpticalPropertyRegistry::Load()", "OptProp002", FatalException, ed);
+    }
+  }
+
+  return table;
+}
+
+G4MaterialPropertyVector* OpticalPropertyRegistry::MakeVector(const std::vector<G4double>& energy,
+                                                              const std::vector<G4double>& value)
+{
+  nRequested++;
+
+  // Linear interpolation of the input on n uniform bins; dense inputs keep
+  // at least their own number of points.
+  std::size_t n = std::max<std::size_t>(nBins, energy.size());
+  G4double eMin = energy.front();
+  G4double eMax = energy.back();
+  G4double step = (eMax - eMin)/(n - 1);
+
+  std::vector<G4double> e(n), v(n);
+  std::size_t j = 0;
+  for (std::size_t i=0; i<n; i++) {
+    e[i] = (i == n - 1) ? eMax : eMin + i*step;
+    while (j + 2 < energy.size() && energy[j + 1] < e[i]) j++;
+    G4double width = energy[j + 1] - energy[j];
+    G4double frac = width > 0. ? (e[i] - energy[j])/width : 0.;
+    v[i] = value[j] + std::min(std::max(frac, 0.), 1.)*(value[j + 1] - value[j]);
+  }
+
+  std::vector<G4double> key(e);
+  key.insert(key.end(), v.begin(), v.end());
+  auto it = vectors.find(key);
+  if (it != vectors.end()) return it->second;
+
+  G4MaterialPropertyVector* vec = new G4MaterialPropertyVector(e, v);
+#if G4VERSION_NUMBER >= 1100
+  vec->EnableLogBinSearch();
+#endif
+  vectors[key] = vec;
+  return vec;
+}
+
+G4double OpticalPropertyRegistry::ParseUnit(const G4String& unit, const G4String& fileName) const
+{
+  if (unit == "1") return 1.;
+  if (unit.size() > 2 && unit.substr(0, 2) == "1/") {
+    return 1./ParseUnit(unit.substr(2), fileName);
+  }
+  if (!G4UnitDefinition::IsUnitDefined(unit)) {
+    G4ExceptionDescription ed;
+    ed << fileName << ": unknown unit " << unit;
+    G4Exception("OpticalPropertyRegistry::ParseUnit()", "OptProp004", FatalException, ed);
+    return 1.;
+  }
+  return G4UnitDefinition::GetValueOf(unit);
+}
+
+void OpticalPropertyRegistry::Report() const
+{
+  G4cout << "Optical properties: " << tables.size() << " tables from " << dataDir << ", "
+         << nRequested << " spectra resampled to >= " << nBins << " uniform bins, "
+         << vectors.size() << " distinct vectors" << G4endl;
+}
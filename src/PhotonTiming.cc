@@ -0,0 +1,93 @@
+#include "PhotonTiming.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cmath>
+
+PhotonTiming::PhotonTiming(G4int nChannels)
+  : kPhoton(0), kArray(10), peakMin(0.), peakMax(0.), times(nChannels), firstTime(nChannels, -1.),
+    kthTime(nChannels, -1.), meanTime(nChannels, -1.), arrayTime(-1.), nEvents(0), mean(0.), m2(0.)
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/timing/", "Photon timing estimators");
+  messenger->DeclareProperty("kPhoton", kPhoton, "k of the per-channel k-th photon estimators (0 = off)")
+    .SetRange("kPhoton>=0")
+    .SetStates(G4State_PreInit, G4State_Idle);
+  messenger->DeclareProperty("kArray", kArray, "k of the array timestamp (k-th photon of all channels)")
+    .SetRange("kArray>0");
+  messenger->DeclarePropertyWithUnit("peakMin", "keV", peakMin, "Lower edge of the LaBr3 Edep window of the CTR estimate");
+  messenger->DeclarePropertyWithUnit("peakMax", "keV", peakMax, "Upper edge of the LaBr3 Edep window (0 = all events)");
+}
+
+PhotonTiming::~PhotonTiming()
+{
+  delete messenger;
+}
+
+void PhotonTiming::Reset()
+{
+  nEvents = 0;
+  mean = 0.;
+  m2 = 0.;
+}
+
+void PhotonTiming::Clear()
+{
+  for (auto& channel : times) channel.clear();
+  allTimes.clear();
+}
+
+void PhotonTiming::AddPhoton(G4int channel, G4double time)
+{
+  times[channel].push_back(time);
+}
+
+// Leaves the k smallest times, unordered, in front of the k-th one
+void PhotonTiming::Estimate(std::vector<G4double>& t, G4int k, G4double& kth, G4double& kMean)
+{
+  if (G4int(t.size()) < k) {
+    kth = -1.;
+    kMean = -1.;
+    return;
+  }
+  std::nth_element(t.begin(), t.begin() + (k - 1), t.end());
+  kth = t[k - 1];
+  G4double sum = 0.;
+  for (G4int i=0; i<k; i++) sum += t[i];
+  kMean = sum/k;
+}
+
+void PhotonTiming::EndOfEvent(G4double edepLaBr3)
+{
+  if (!IsActive()) return;
+
+  for (std::size_t i=0; i<times.size(); i++) {
+    std::vector<G4double>& t = times[i];
+    firstTime[i] = t.empty() ? -1. : *std::min_element(t.begin(), t.end());
+    Estimate(t, kPhoton, kthTime[i], meanTime[i]);
+    allTimes.insert(allTimes.end(), t.begin(), t.end());
+  }
+
+  G4double arrayMean;
+  Estimate(allTimes, kArray, arrayTime, arrayMean);
+  if (arrayTime < 0.) return;
+  if (peakMax > peakMin && (edepLaBr3 < peakMin || edepLaBr3 > peakMax)) return;
+
+  nEvents++;
+  G4double delta = arrayTime - mean;
+  mean += delta/nEvents;
+  m2 += delta*(arrayTime - mean);
+}
+
+void PhotonTiming::Report() const
+{
+  if (!IsActive() || nEvents < 2) return;
+
+  G4double sigma = std::sqrt(m2/(nEvents - 1));
+  G4double fwhm = 2.*std::sqrt(2.*std::log(2.))*sigma;
+  G4cout << "PhotonTiming: " << nEvents << " events, array timestamp (photon " << kArray << ") "
+         << mean/ns << " ns, sigma " << sigma/ps << " ps, FWHM " << fwhm/ps << " ps, CTR "
+         << std::sqrt(2.)*fwhm/ps << " ps" << G4endl;
+}
@@ -1,29 +1,112 @@
 #include "PhysicsList.hh"
+#include "BiasedRDPhysics.hh"
 
 #include "G4EmLivermorePolarizedPhysics.hh"
+#include "G4EmLivermorePhysics.hh"
 #include "G4EmStandardPhysics_option4.hh"
 #include "G4EmStandardPhysics.hh"
 #include "G4OpticalParameters.hh"
+#include "G4GenericMessenger.hh"
 #include "G4OpticalPhysics.hh"
 #include "G4ParticleTypes.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4EmParameters.hh"
+#include "G4ProductionCuts.hh"
+#include "G4RegionStore.hh"
+#include "G4Region.hh"
 
 PhysicsList::PhysicsList() : G4VModularPhysicsList()
 {
   defaultCutValue = 0.01*mm;
+  cutLaBr3 = defaultCutValue;
+  cutBGO = defaultCutValue;
+  cutPassive = defaultCutValue;
 
   G4OpticalPhysics* opticalPhysics = new G4OpticalPhysics();
   auto opticalParams = G4OpticalParameters::Instance();
   opticalParams->SetScintTrackSecondariesFirst(true);
   RegisterPhysics(opticalPhysics);
   RegisterPhysics(new G4EmLivermorePolarizedPhysics());
+
+  messenger = new G4GenericMessenger(this, "/LaBr/phys/", "Physics list options");
+  messenger->DeclareMethod("addRadioactiveDecay", &PhysicsList::AddRadioactiveDecay,
+                           "Register biased radioactive decay (configure with /LaBr/rdm/)")
+    .SetStates(G4State_PreInit);
+  messenger->DeclareMethod("yieldOnly", &PhysicsList::SetYieldOnly,
+                           "Count scintillation and Cerenkov photons without generating them")
+    .SetStates(G4State_PreInit);
+  messenger->DeclareMethod("em", &PhysicsList::SetEmPhysics, "EM physics constructor of the whole setup")
+    .SetCandidates("standard opt4 livermore polarized")
+    .SetStates(G4State_PreInit);
+  messenger->DeclareMethod("crystalEm", &PhysicsList::SetCrystalEmPhysics, "EM option applied in LaBr3Region only")
+    .SetCandidates("G4EmStandard_opt4 G4EmLivermore G4EmPenelope")
+    .SetStates(G4State_PreInit);
+  messenger->DeclareMethodWithUnit("cutLaBr3", "mm", &PhysicsList::SetCutLaBr3, "Production cut in the LaBr3 crystal")
+    .SetStates(G4State_PreInit, G4State_Idle);
+  messenger->DeclareMethodWithUnit("cutBGO", "mm", &PhysicsList::SetCutBGO, "Production cut in the BGO bars and their SiPMs")
+    .SetStates(G4State_PreInit, G4State_Idle);
+  messenger->DeclareMethodWithUnit("cutPassive", "mm", &PhysicsList::SetCutPassive, "Production cut in the reflector and housing")
+    .SetStates(G4State_PreInit, G4State_Idle);
 }
 
 
 PhysicsList::~PhysicsList()
-{}
+{
+  delete messenger;
+}
 
 void PhysicsList::SetCuts()
 {
   SetCutsWithDefault();
+  SetRegionCut("LaBr3Region", cutLaBr3);
+  SetRegionCut("BGORegion", cutBGO);
+  SetRegionCut("PassiveRegion", cutPassive);
+}
+
+// Regions are made by DetectorConstruction; before that the value is only
+// stored and applied by SetCuts.
+void PhysicsList::SetRegionCut(const G4String& regionName, G4double cut)
+{
+  G4Region* region = G4RegionStore::GetInstance()->GetRegion(regionName, false);
+  if (!region) return;
+
+  G4ProductionCuts* cuts = region->GetProductionCuts();
+  if (!cuts) {
+    cuts = new G4ProductionCuts();
+    region->SetProductionCuts(cuts);
+  }
+  cuts->SetProductionCut(cut);
+}
+
+void PhysicsList::SetEmPhysics(G4String name)
+{
+  if (name == "standard") {
+    ReplacePhysics(new G4EmStandardPhysics());
+  } else if (name == "opt4") {
+    ReplacePhysics(new G4EmStandardPhysics_option4());
+  } else if (name == "livermore") {
+    ReplacePhysics(new G4EmLivermorePhysics());
+  } else if (name == "polarized") {
+    ReplacePhysics(new G4EmLivermorePolarizedPhysics());
+  }
+}
+
+void PhysicsList::SetCrystalEmPhysics(G4String type)
+{
+  G4EmParameters::Instance()->AddPhysics("LaBr3Region", type);
+}
+
+void PhysicsList::AddRadioactiveDecay()
+{
+  if (GetPhysics("BiasedRDPhysics")) return;
+  RegisterPhysics(new BiasedRDPhysics(verboseLevel));
+}
+
+void PhysicsList::SetYieldOnly(G4bool val)
+{
+  // The processes still compute the number of photons of every step
+  // (read back in SteppingAction) but do not put them on the stack.
+  auto opticalParams = G4OpticalParameters::Instance();
+  opticalParams->SetScintStackPhotons(!val);
+  opticalParams->SetCerenkovStackPhotons(!val);
 }
@@ -1,11 +1,21 @@
 #include "PrimaryGeneratorAction.hh"
+#include "PrimaryList.hh"
 
 #include "G4GeneralParticleSource.hh"
+#include "G4SPSPosDistribution.hh"
+#include "G4SingleParticleSource.hh"
 #include "G4ParticleDefinition.hh"
+#include "G4GenericMessenger.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
 #include "G4ParticleTable.hh"
 #include "G4ParticleGun.hh"
 #include "G4ThreeVector.hh"
+#include "G4IonTable.hh"
 #include "G4Event.hh"
+#include "Randomize.hh"
 #include "globals.hh"
 #include "G4ios.hh"
 
@@ -13,18 +23,211 @@
 #include <iomanip>
 
 PrimaryGeneratorAction::PrimaryGeneratorAction()
+  : messenger(nullptr), sourceMode("gps"), listFileName(""), batchSize(4096), loopList(false), primaryList(nullptr), listPosition(0),
+    lineIntensity(1.), rate(0.), window(0.)
 {
   particleGun = new G4GeneralParticleSource();
   particleGun->SetCurrentSourceIntensity(1);
   particleGun->SetParticlePosition(G4ThreeVector());
+
+  DefineCommands();
 }
 
 PrimaryGeneratorAction::~PrimaryGeneratorAction()
 {
+  delete primaryList;
+  delete messenger;
   delete particleGun;
 }
 
 void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
-  particleGun->GeneratePrimaryVertex(anEvent);
+  GenerateDecay(anEvent, 0.);
+
+  if (rate > 0. && window > 0.) {
+    G4long nPileUp = CLHEP::RandPoisson::shoot(rate*window);
+    for (G4long i=0; i<nPileUp; i++) {
+      GenerateDecay(anEvent, G4UniformRand()*window);
+    }
+  }
+}
+
+void PrimaryGeneratorAction::GenerateDecay(G4Event* anEvent, G4double t0)
+{
+  if (sourceMode == "list") {
+    GenerateListDecay(anEvent, t0);
+  } else if (sourceMode == "cascade") {
+    GenerateCascadeDecay(anEvent, t0);
+  } else {
+    G4int nVertex = anEvent->GetNumberOfPrimaryVertex();
+    particleGun->GeneratePrimaryVertex(anEvent);
+    for (G4int i=nVertex; i<anEvent->GetNumberOfPrimaryVertex(); i++) {
+      G4PrimaryVertex* vertex = anEvent->GetPrimaryVertex(i);
+      vertex->SetT0(vertex->GetT0() + t0);
+    }
+  }
+}
+
+void PrimaryGeneratorAction::GenerateListDecay(G4Event* anEvent, G4double t0)
+{
+  if (!primaryList) {
+    primaryList = new PrimaryList(listFileName, batchSize);
+    primaryList->Seek(listPosition);
+  }
+
+  const PrimaryRecord* rec = primaryList->Next();
+  if (!rec && loopList) {
+    primaryList->Rewind();
+    rec = primaryList->Next();
+  }
+  if (!rec) {
+    G4Exception("PrimaryGeneratorAction::GenerateListDecay()", "PrimGen001", EventMustBeAborted,
+                "Primary list exhausted; use /LaBr/source/loop true to reuse it");
+    return;
+  }
+
+  G4int decay = rec->decay;
+  while (rec) {
+    G4PrimaryVertex* vertex = new G4PrimaryVertex(G4ThreeVector(rec->pos[0]*mm, rec->pos[1]*mm, rec->pos[2]*mm), t0 + rec->time*ns);
+    G4PrimaryParticle* particle = new G4PrimaryParticle(FindParticle(rec->pdg));
+    particle->SetKineticEnergy(rec->energy*MeV);
+    particle->SetMomentumDirection(G4ThreeVector(rec->dir[0], rec->dir[1], rec->dir[2]).unit());
+    vertex->SetPrimary(particle);
+    anEvent->AddPrimaryVertex(vertex);
+
+    rec = primaryList->Peek();
+    if (!rec || rec->decay != decay) break;
+    primaryList->Next();
+  }
+}
+
+void PrimaryGeneratorAction::GenerateCascadeDecay(G4Event* anEvent, G4double t0)
+{
+  G4ThreeVector position = particleGun->GetCurrentSource()->GetPosDist()->GenerateOne();
+  G4PrimaryVertex* vertex = new G4PrimaryVertex(position, t0);
+  G4ParticleDefinition* gamma = FindParticle(22);
+
+  for (const auto& line : cascade) {
+    if (G4UniformRand() >= line.intensity) continue;
+
+    G4double cosTheta = 2.*G4UniformRand() - 1.;
+    G4double sinTheta = std::sqrt(1. - cosTheta*cosTheta);
+    G4double phi = twopi*G4UniformRand();
+    G4ThreeVector dir(sinTheta*std::cos(phi), sinTheta*std::sin(phi), cosTheta);
+
+    G4PrimaryParticle* particle = new G4PrimaryParticle(gamma);
+    particle->SetKineticEnergy(line.energy);
+    particle->SetMomentumDirection(dir);
+    vertex->SetPrimary(particle);
+
+    if (line.annihilation) {
+      G4PrimaryParticle* partner = new G4PrimaryParticle(gamma);
+      partner->SetKineticEnergy(line.energy);
+      partner->SetMomentumDirection(-dir);
+      vertex->SetPrimary(partner);
+    }
+  }
+
+  if (vertex->GetNumberOfParticle() > 0) {
+    anEvent->AddPrimaryVertex(vertex);
+  } else {
+    delete vertex;
+  }
+}
+
+G4ParticleDefinition* PrimaryGeneratorAction::FindParticle(G4int pdg)
+{
+  auto it = particleCache.find(pdg);
+  if (it != particleCache.end()) return it->second;
+
+  G4ParticleDefinition* particle = nullptr;
+  if (pdg > 1000000000) {
+    particle = G4IonTable::GetIonTable()->GetIon(pdg);
+  } else {
+    particle = G4ParticleTable::GetParticleTable()->FindParticle(pdg);
+  }
+  if (!particle) {
+    G4ExceptionDescription ed;
+    ed << "Unknown PDG code " << pdg << " in primary list " << listFileName;
+    G4Exception("PrimaryGeneratorAction::FindParticle()", "PrimGen002", FatalException, ed);
+  }
+  particleCache[pdg] = particle;
+  return particle;
+}
+
+void PrimaryGeneratorAction::SetSourceMode(G4String mode)
+{
+  sourceMode = mode;
+  if (sourceMode == "cascade" && cascade.empty()) {
+    G4cerr << "Warning: cascade source selected but no lines defined (/LaBr/source/cascadePreset)" << G4endl;
+  }
+}
+
+void PrimaryGeneratorAction::SetListFile(G4String name)
+{
+  listFileName = name;
+  listPosition = 0;
+  delete primaryList;
+  primaryList = nullptr;
+}
+
+G4long PrimaryGeneratorAction::GetListPosition() const
+{
+  return primaryList ? G4long(primaryList->Tell()) : listPosition;
+}
+
+// Applied now, or when the list is opened by the first event
+void PrimaryGeneratorAction::SetListPosition(G4long record)
+{
+  listPosition = record;
+  if (primaryList) primaryList->Seek(record);
+}
+
+void PrimaryGeneratorAction::AddCascadeLine(G4double energy)
+{
+  cascade.push_back({energy, lineIntensity, false});
+}
+
+void PrimaryGeneratorAction::AddAnnihilation()
+{
+  cascade.push_back({electron_mass_c2, lineIntensity, true});
+}
+
+void PrimaryGeneratorAction::SetCascadePreset(G4String nuclide)
+{
+  cascade.clear();
+  if (nuclide == "Co60") {
+    cascade.push_back({1173.228*keV, 0.9985, false});
+    cascade.push_back({1332.492*keV, 0.9998, false});
+  } else if (nuclide == "Cs137") {
+    cascade.push_back({661.657*keV, 0.851, false});
+  } else if (nuclide == "Na22") {
+    cascade.push_back({1274.537*keV, 0.9994, false});
+    cascade.push_back({electron_mass_c2, 0.9030, true});
+  } else {
+    G4cerr << "Unknown cascade preset " << nuclide << G4endl;
+  }
+}
+
+void PrimaryGeneratorAction::DefineCommands()
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/source/", "Primary source engine");
+
+  messenger->DeclareMethod("mode", &PrimaryGeneratorAction::SetSourceMode, "Source mode")
+    .SetCandidates("gps list cascade")
+    .SetDefaultValue("gps");
+  messenger->DeclareMethod("listFile", &PrimaryGeneratorAction::SetListFile, "Binary primary list file");
+  messenger->DeclareProperty("batchSize", batchSize, "Number of list records prefetched at once")
+    .SetRange("batchSize>0");
+  messenger->DeclareProperty("loop", loopList, "Restart the primary list when it is exhausted");
+  messenger->DeclarePropertyWithUnit("rate", "Hz", rate, "Decay rate used for pile-up (0 disables it)");
+  messenger->DeclarePropertyWithUnit("window", "ns", window, "Integration window of one event");
+
+  messenger->DeclareProperty("lineIntensity", lineIntensity, "Emission probability of the cascade lines added next")
+    .SetRange("lineIntensity>=0 && lineIntensity<=1");
+  messenger->DeclareMethodWithUnit("addGamma", "keV", &PrimaryGeneratorAction::AddCascadeLine, "Add a gamma line to the cascade");
+  messenger->DeclareMethod("addAnnihilation", &PrimaryGeneratorAction::AddAnnihilation, "Add a back-to-back 511 keV pair to the cascade");
+  messenger->DeclareMethod("cascadePreset", &PrimaryGeneratorAction::SetCascadePreset, "Load a predefined cascade")
+    .SetCandidates("Co60 Cs137 Na22");
+  messenger->DeclareMethod("clearCascade", &PrimaryGeneratorAction::ClearCascade, "Remove all cascade lines");
 }
@@ -0,0 +1,117 @@
+#include "PrimaryList.hh"
+
+#include "G4ios.hh"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+PrimaryList::PrimaryList(const G4String& name, G4int nBatch)
+  : fileName(name), fd(-1), mapped(nullptr), mappedSize(0), records(nullptr), nRecords(0), nextRecord(0),
+    batchSize(nBatch > 0 ? nBatch : 1), batchPos(0)
+{
+  fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    G4ExceptionDescription ed;
+    ed << "Cannot open primary list file " << fileName;
+    G4Exception("PrimaryList::PrimaryList()", "PrimList001", FatalException, ed);
+    return;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    G4ExceptionDescription ed;
+    ed << "Cannot read the size of primary list file " << fileName;
+    G4Exception("PrimaryList::PrimaryList()", "PrimList001", FatalException, ed);
+    return;
+  }
+  mappedSize = st.st_size;
+  if (mappedSize < sizeof(PrimaryListHeader)) {
+    G4ExceptionDescription ed;
+    ed << "Primary list file " << fileName << " is too short";
+    G4Exception("PrimaryList::PrimaryList()", "PrimList002", FatalException, ed);
+    return;
+  }
+
+  mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapped == MAP_FAILED) {
+    mapped = nullptr;
+    G4ExceptionDescription ed;
+    ed << "Cannot map primary list file " << fileName;
+    G4Exception("PrimaryList::PrimaryList()", "PrimList003", FatalException, ed);
+    return;
+  }
+  madvise(mapped, mappedSize, MADV_SEQUENTIAL);
+
+  const PrimaryListHeader* header = static_cast<const PrimaryListHeader*>(mapped);
+  if (std::memcmp(header->magic, "LABRPRIM", 8) != 0 || header->version != 1 || header->recordSize != sizeof(PrimaryRecord)) {
+    G4ExceptionDescription ed;
+    ed << fileName << " is not a version 1 primary list file";
+    G4Exception("PrimaryList::PrimaryList()", "PrimList004", FatalException, ed);
+    return;
+  }
+
+  records = reinterpret_cast<const PrimaryRecord*>(static_cast<const char*>(mapped) + sizeof(PrimaryListHeader));
+  nRecords = (mappedSize - sizeof(PrimaryListHeader))/sizeof(PrimaryRecord);
+  batch.reserve(batchSize);
+
+  G4cout << "Primary list " << fileName << ": " << nRecords << " records, batches of " << batchSize << G4endl;
+}
+
+PrimaryList::~PrimaryList()
+{
+  if (mapped) munmap(mapped, mappedSize);
+  if (fd >= 0) close(fd);
+}
+
+const PrimaryRecord* PrimaryList::Next()
+{
+  const PrimaryRecord* rec = Peek();
+  if (rec) batchPos++;
+  return rec;
+}
+
+const PrimaryRecord* PrimaryList::Peek()
+{
+  if (batchPos >= batch.size()) {
+    Prefetch();
+  }
+  return batchPos < batch.size() ? &batch[batchPos] : nullptr;
+}
+
+void PrimaryList::Rewind()
+{
+  nextRecord = 0;
+  batch.clear();
+  batchPos = 0;
+}
+
+void PrimaryList::Seek(std::size_t record)
+{
+  nextRecord = std::min(record, nRecords);
+  batch.clear();
+  batchPos = 0;
+}
+
+void PrimaryList::Prefetch()
+{
+  batch.clear();
+  batchPos = 0;
+  if (!records || nextRecord >= nRecords) return;
+
+  std::size_t n = std::min(batchSize, nRecords - nextRecord);
+  batch.assign(records + nextRecord, records + nextRecord + n);
+  nextRecord += n;
+
+  // Ask for the next batch while this one is being tracked.
+  if (nextRecord < nRecords) {
+    const long page = sysconf(_SC_PAGESIZE);
+    std::size_t begin = sizeof(PrimaryListHeader) + nextRecord*sizeof(PrimaryRecord);
+    std::size_t length = std::min(batchSize, nRecords - nextRecord)*sizeof(PrimaryRecord);
+    std::size_t aligned = begin - begin % page;
+    madvise(static_cast<char*>(mapped) + aligned, length + (begin - aligned), MADV_WILLNEED);
+  }
+}
@@ -1,4 +1,9 @@
 #include "RunAction.hh"
+#include "ConvergenceMonitor.hh"
+#include "PhotonTiming.hh"
+#include "EventAction.hh"
+#include "HistoManager.hh"
+#include "MemoryUsage.hh"
 #include "Analysis.hh"
 
 #include "G4SystemOfUnits.hh"
@@ -9,16 +14,42 @@
 
 #include <iomanip>
 
-RunAction::RunAction() : G4UserRunAction()
-{}
+RunAction::RunAction(G4String nameAdd) : G4UserRunAction()
+{
+  histoManager = new HistoManager("Histos_" + nameAdd);
+  convergenceMonitor = new ConvergenceMonitor();
+  photonTiming = new PhotonTiming(EventAction::kNSiPM);
+}
 
 RunAction::~RunAction()
-{}
+{
+  delete photonTiming;
+  delete convergenceMonitor;
+  delete histoManager;
+}
 
-void RunAction::BeginOfRunAction(const G4Run*)
-{}
+void RunAction::BeginOfRunAction(const G4Run* run)
+{
+  convergenceMonitor->Reset();
+  photonTiming->Reset();
+
+  // One file per run, a later /run/beamOn would otherwise overwrite it
+  G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+  if (analysisManager->IsActive()) {
+    analysisManager->OpenFile(histoManager->GetFileName(run->GetRunID()));
+  }
+}
 
 void RunAction::EndOfRunAction(const G4Run* run)
 {
-  G4cout << "#### Run  " << run->GetRunID() << " stop." << G4endl;
+  MemoryUsage memory = MemoryUsage::Read();
+  G4cout << "#### Run  " << run->GetRunID() << " stop.   RSS " << memory.rss << " MB, peak " << memory.peakRss << " MB" << G4endl;
+  convergenceMonitor->Report();
+  photonTiming->Report();
+
+  G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+  if (analysisManager->IsActive()) {
+    analysisManager->Write();
+    analysisManager->CloseFile();
+  }
 }
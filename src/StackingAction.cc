@@ -0,0 +1,104 @@
+#include "StackingAction.hh"
+#include "EventAction.hh"
+#include "SubEventPool.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4EventManager.hh"
+#include "G4StackManager.hh"
+#include "G4Track.hh"
+#include "G4ios.hh"
+
+StackingAction::StackingAction(EventAction* evAction)
+  : G4UserStackingAction(), eventAction(evAction), subEventPool(nullptr), opticalPhoton(nullptr), lLaBr3(nullptr), lBGO(nullptr),
+    minEdep(0.), peakMin(0.), peakMax(0.), opticalStage(false), nEvents(0), nAccepted(0), nRejected(0)
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/filter/", "Event filter before optical photon tracking");
+  messenger->DeclarePropertyWithUnit("minEdep", "keV", minEdep, "Minimum LaBr3 deposit (0 = off)");
+  messenger->DeclarePropertyWithUnit("peakMin", "keV", peakMin, "Lower edge of the required LaBr3 deposit window");
+  messenger->DeclarePropertyWithUnit("peakMax", "keV", peakMax, "Upper edge of the required LaBr3 deposit window (0 = off)");
+}
+
+StackingAction::~StackingAction()
+{
+  PrintStatistics();
+  delete messenger;
+}
+
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* aTrack)
+{
+  if (!opticalPhoton) {
+    opticalPhoton = G4OpticalPhoton::Definition();
+    lLaBr3 = G4LogicalVolumeStore::GetInstance()->GetVolume("lLaBr3");
+    lBGO = G4LogicalVolumeStore::GetInstance()->GetVolume("BGO");
+  }
+
+  if (aTrack->GetDefinition() == opticalPhoton && eventAction->IsVetoed()
+      && aTrack->GetVolume()->GetLogicalVolume() == lBGO) {
+    return fKill;
+  }
+  if (!opticalStage && IsActive() && aTrack->GetDefinition() == opticalPhoton) {
+    return fWaiting;
+  }
+  // Tracked at the end of the event by the sub-event workers
+  if (subEventPool && subEventPool->IsActive() && aTrack->GetDefinition() == opticalPhoton
+      && aTrack->GetVolume()->GetLogicalVolume() == lLaBr3) {
+    subEventPool->AddPhoton(aTrack);
+    return fKill;
+  }
+  return fUrgent;
+}
+
+G4bool StackingAction::Passes() const
+{
+  G4double edep = eventAction->GetEdep(EventAction::kSlotLaBr3);
+  G4bool pass = edep >= minEdep;
+  if (peakMax > 0.) pass = pass && edep >= peakMin && edep <= peakMax;
+  return pass;
+}
+
+void StackingAction::NewStage()
+{
+  if (opticalStage || !IsActive()) return;
+
+  if (!Passes()) {
+    nRejected++;
+    G4EventManager::GetEventManager()->AbortCurrentEvent();
+    return;
+  }
+
+  nAccepted++;
+  opticalStage = true;
+  stackManager->ReClassify();
+}
+
+void StackingAction::PrepareNewEvent()
+{
+  opticalStage = false;
+  if (IsActive()) nEvents++;
+}
+
+// Called at the end of events that were not aborted
+G4bool StackingAction::AcceptEvent()
+{
+  if (opticalStage || !IsActive()) return true;
+
+  opticalStage = true;
+  if (!Passes()) {
+    nRejected++;
+    return false;
+  }
+  nAccepted++;
+  return true;
+}
+
+void StackingAction::PrintStatistics() const
+{
+  if (nEvents == 0) return;
+
+  G4cout << "Event filter: " << nEvents << " events, " << nAccepted << " accepted, " << nRejected << " rejected ("
+         << 100.*nRejected/nEvents << " %), "
+         << nEvents - nAccepted - nRejected << " aborted before the decision" << G4endl;
+}
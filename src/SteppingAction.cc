@@ -2,9 +2,26 @@
 #include "DetectorConstruction.hh"
 #include "SteppingAction.hh"
 #include "EventAction.hh"
+#include "Watchdog.hh"
 
 #include "G4GeneralParticleSource.hh"
+#include "G4GenericMessenger.hh"
 #include "G4ParticleDefinition.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4HadronicProcessType.hh"
+#include "G4OpProcessSubType.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4LossTableManager.hh"
+#include "G4EmSaturation.hh"
+#include "G4Scintillation.hh"
+#include "G4ProcessTable.hh"
+#include "G4Cerenkov.hh"
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4NavigationHistory.hh"
+#include "G4AffineTransform.hh"
+#include "Randomize.hh"
 #include "G4SteppingManager.hh"
 #include "G4VPhysicalVolume.hh"
 #include "G4ParticleTypes.hh"
@@ -15,136 +32,448 @@
 #include "G4Track.hh"
 #include "G4Step.hh"
 
+#include "TParameter.h"
+#include "TBranch.h"
+#include "TBasket.h"
+#include "TBuffer.h"
 #include "TH2F.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 
 using namespace std;	 
 
-SteppingAction::SteppingAction(G4int *evN, G4String nameAdd) : G4UserSteppingAction(), fout(nullptr), tout(nullptr), foutName("Output_" + nameAdd + ".root")
+namespace
+{
+  // Point in the frame of the module the touchable is in, moduleDepth levels
+  // above its volume, so that positions do not depend on where the module is
+  // placed in the array
+  G4ThreeVector ModulePosition(const G4TouchableHandle& touchable, G4int moduleDepth, const G4ThreeVector& global)
+  {
+    const G4NavigationHistory* history = touchable->GetHistory();
+    return history->GetTransform(history->GetDepth() - moduleDepth).TransformPoint(global);
+  }
+
+  G4ThreeVector ModuleDirection(const G4TouchableHandle& touchable, G4int moduleDepth, const G4ThreeVector& global)
+  {
+    const G4NavigationHistory* history = touchable->GetHistory();
+    return history->GetTransform(history->GetDepth() - moduleDepth).TransformAxis(global);
+  }
+}
+
+SteppingAction::SteppingAction(G4int *evN, G4String nameAdd, EventAction* evAction)
+  : G4UserSteppingAction(), tout(nullptr), eventAction(evAction), subEventPool(nullptr), writeStepTree(true), writeEdepSteps(true),
+    autoSaveEvery(0), basketMemory(0.), lastEvent(-1), eventsSinceSave(0), nBlocks(0),
+    opticalPhoton(nullptr), lLaBr3(nullptr), lBGO(nullptr), lSiPM(nullptr), lReflector(nullptr), lReflectorFace(nullptr),
+    lTeflon(nullptr), lHousing(nullptr), physiBGOSiPM(nullptr), emSaturation(nullptr),
+    scintillation(nullptr), cerenkov(nullptr), couplingThickness(0.), greaseRindex(nullptr), greaseAbsLength(nullptr),
+    sipmRindex(nullptr), nSteps(0), nOpticalSteps(0), nFastPath(0), nOpticalPhotons(0), nRows(0), nCouplingAbsorbed(0), nEvents(0), foutName("Output_" + nameAdd + ".root")
 { 
   evNr = evN;
-  counter = 0;
+  watchdog = new Watchdog(nameAdd);
+
+  messenger = new G4GenericMessenger(this, "/LaBr/output/", "Output control");
+  messenger->DeclareProperty("stepTree", writeStepTree, "Write the per-step tree T (histograms are always filled)");
+  messenger->DeclareProperty("edepSteps", writeEdepSteps, "Write the LaBr3 energy deposit steps (Det 11) to T, needed by LaBrAna positions and spectra");
+  messenger->DeclareProperty("autoSaveEvery", autoSaveEvery,
+                             "Save T every N events and announce the block in <file>.blocks (0 = only at the end)")
+    .SetRange("autoSaveEvery>=0");
+  messenger->DeclareProperty("basketMemory", basketMemory,
+                             "Memory budget of the T baskets in MB, flushed at event boundaries (0 = ROOT defaults)")
+    .SetRange("basketMemory>=0");
 }
 
 void SteppingAction::InitOutput()
 {
-  fout = new TFile(foutName.c_str(),"RECREATE");
+  fout.reset(new TFile(foutName.c_str(),"RECREATE"));
   tout = new TTree("T","Stepping action Event Tree");
-  tout->Branch("evNr", &eventNr, "evNr/I");
-  tout->Branch("pType", &pType, "pType/I");
-  tout->Branch("pName", &pName, "pName/I");
-  tout->Branch("KE", &KE, "KE/D");
-  tout->Branch("Edep", &Edep, "Edep/D");
-  tout->Branch("postPosX", &postPosX, "postPosX/D");
-  tout->Branch("postPosY", &postPosY, "postPosY/D");
-  tout->Branch("postPosZ", &postPosZ, "postPosZ/D");
-  tout->Branch("Det", &Det, "Det/I");
-  tout->Branch("CopyNo", &CopyNo, "CopyNo/I");
-  tout->Branch("Gtime", &Gtime, "Gtime/D");
-  tout->Branch("momentumX", &momentumX, "momentumX/D");
-  tout->Branch("momentumY", &momentumY, "momentumY/D");
-  tout->Branch("momentumZ", &momentumZ, "momentumZ/D");
+  AttachBranches(true);
+
+  // With a budget ROOT no longer flushes and resizes the baskets on its
+  // own; EndOfEvent flushes them once the unwritten data reaches the budget.
+  if (basketMemory > 0.) {
+    Long64_t budget = Long64_t(basketMemory*1024*1024);
+    Int_t nBranches = tout->GetListOfBranches()->GetEntries();
+    tout->SetAutoFlush(0);
+    tout->SetBasketSize("*", std::max<Long64_t>(budget/nBranches, 1024));
+  }
+
+  // Readers following the run (LaBrAna --follow) poll this list of saved blocks
+  std::ofstream blocks(foutName + ".blocks", std::ios::trunc);
+}
+
+// The same variables are attached to a new tree or, on resume, to the
+// tree read back from a checkpointed file.
+void SteppingAction::AttachBranches(G4bool create)
+{
+  auto attach = [this, create](const char* name, void* address, const char* leaves) {
+    if (create) tout->Branch(name, address, leaves);
+    else tout->SetBranchAddress(name, address);
+  };
+  attach("evNr", &eventNr, "evNr/I");
+  attach("pType", &pType, "pType/I");
+  attach("pName", &pName, "pName/I");
+  attach("KE", &KE, "KE/D");
+  attach("Edep", &Edep, "Edep/D");
+  attach("postPosX", &postPosX, "postPosX/D");
+  attach("postPosY", &postPosY, "postPosY/D");
+  attach("postPosZ", &postPosZ, "postPosZ/D");
+  attach("Det", &Det, "Det/I");
+  attach("CopyNo", &CopyNo, "CopyNo/I");
+  attach("Gtime", &Gtime, "Gtime/D");
+  attach("momentumX", &momentumX, "momentumX/D");
+  attach("momentumY", &momentumY, "momentumY/D");
+  attach("momentumZ", &momentumZ, "momentumZ/D");
+  attach("weight", &weight, "weight/D");
+}
+
+// Called at the end of an event, when all of its rows are filled
+Long64_t SteppingAction::SaveCheckpoint()
+{
+  if (!fout) return 0;
+  SaveBlock();
+  return tout->GetEntries();
+}
+
+// Rows after the last auto-save of an unclosed file are lost, so the
+// file is only continued when it holds exactly the checkpointed entries.
+G4bool SteppingAction::ResumeOutput(const G4String& fileName, Long64_t entries)
+{
+  std::unique_ptr<TFile> file(new TFile(fileName.c_str(), "UPDATE"));
+  TTree* tree = nullptr;
+  if (!file->IsZombie()) file->GetObject("T", tree);
+  if (!tree || tree->GetEntries() != entries) return false;
+
+  fout = std::move(file);
+  tout = tree;
+  foutName = fileName;
+  AttachBranches(false);
+  return true;
+}
+
+void SteppingAction::EndOfEvent()
+{
+  if (autoSaveEvery > 0 && ++eventsSinceSave >= autoSaveEvery) {
+    SaveBlock();
+  } else if (basketMemory > 0. && BufferedBytes() > basketMemory*1024*1024) {
+    tout->FlushBaskets();
+  }
+  eventAction->SetTreeBufferBytes(BufferedBytes());
+}
+
+// Data of T held in the write baskets, not yet written to the file
+Long64_t SteppingAction::BufferedBytes() const
+{
+  Long64_t bytes = 0;
+  TObjArray* branches = tout->GetListOfBranches();
+  for (Int_t i=0; i<branches->GetEntries(); i++) {
+    TBranch* branch = static_cast<TBranch*>(branches->UncheckedAt(i));
+    TBasket* basket = static_cast<TBasket*>(branch->GetListOfBaskets()->UncheckedAt(branch->GetWriteBasket()));
+    if (basket) bytes += basket->GetBufferRef()->Length() - basket->GetKeylen();
+  }
+  return bytes;
+}
+
+void SteppingAction::SaveBlock()
+{
+  tout->AutoSave("SaveSelf FlushBaskets");
+  nBlocks++;
+  eventsSinceSave = 0;
+
+  std::ofstream blocks(foutName + ".blocks", std::ios::app);
+  blocks << "block " << nBlocks << " " << tout->GetEntries() << " " << lastEvent << std::endl;
 }
 
 SteppingAction::~SteppingAction()
 {
-  if (fout && tout) {
-    fout->cd();
-    tout->Write();
-    fout->Close();
-    G4cout << "End of Stepping Action (file written)" << G4endl;
-  } else {
-    G4cerr << "Warning: Output ROOT file or tree was not initialized!" << G4endl;
+  delete messenger;
+  delete watchdog;
+  PrintStatistics();
+  if (!fout) return;
+  fout->cd();
+  Long64_t nEntries = tout->GetEntries();
+  tout->Write();
+  // Tracking cost, compared between runs by analysis/CompareRuns
+  std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - startTime;
+  TParameter<Long64_t>("OpticalSteps", nOpticalSteps).Write();
+  TParameter<Long64_t>("OpticalPhotons", nOpticalPhotons).Write();
+  TParameter<Long64_t>("Events", nEvents).Write();
+  TParameter<Double_t>("WallTime", wallTime.count()).Write();
+  fout->Close();
+  fout.reset();
+  if (autoSaveEvery > 0) {
+    std::ofstream blocks(foutName + ".blocks", std::ios::app);
+    blocks << "end " << nEntries << std::endl;
+  }
+  G4cout << "End of Stepping Action (file written)" << G4endl;
+}
+
+void SteppingAction::CacheVolumes()
+{
+  opticalPhoton = G4OpticalPhoton::Definition();
+  lLaBr3 = G4LogicalVolumeStore::GetInstance()->GetVolume("lLaBr3");
+  lBGO = G4LogicalVolumeStore::GetInstance()->GetVolume("BGO");
+  lSiPM = G4LogicalVolumeStore::GetInstance()->GetVolume("SiPM");
+  lReflector = G4LogicalVolumeStore::GetInstance()->GetVolume("Reflector");
+  lReflectorFace = G4LogicalVolumeStore::GetInstance()->GetVolume("Reflectorface");
+  lTeflon = G4LogicalVolumeStore::GetInstance()->GetVolume("Teflon");
+  lHousing = G4LogicalVolumeStore::GetInstance()->GetVolume("lhousing");
+  emSaturation = G4LossTableManager::Instance()->EmSaturation();
+
+  // One process instance is shared by all particles
+  G4ProcessTable* processTable = G4ProcessTable::GetProcessTable();
+  scintillation = dynamic_cast<const G4Scintillation*>(processTable->FindProcess("Scintillation", "e-"));
+  cerenkov = dynamic_cast<const G4Cerenkov*>(processTable->FindProcess("Cerenkov", "e-"));
+  physiBGOSiPM = G4PhysicalVolumeStore::GetInstance()->GetVolume("BGO_SiPM");
+
+  const DetectorConstruction* detector =
+    static_cast<const DetectorConstruction*>(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  couplingThickness = detector->GetCouplingThickness();
+  if (couplingThickness > 0.) {
+    const G4MaterialPropertiesTable* grease = G4Material::GetMaterial("Optical_grease")->GetMaterialPropertiesTable();
+    greaseRindex = grease->GetProperty("RINDEX");
+    greaseAbsLength = grease->GetProperty("ABSLENGTH");
+    sipmRindex = G4Material::GetMaterial("optgelmat")->GetMaterialPropertiesTable()->GetProperty("RINDEX");
   }
 }
 
 void SteppingAction::UserSteppingAction(const G4Step* aStep)
 {
-  if (fout == NULL) {
-    InitOutput();
+  if (!opticalPhoton) {
+    CacheVolumes();
+    startTime = std::chrono::steady_clock::now();
   }
+  nSteps++;
 
-  InitVar();
-  eventNr=*evNr;
+  // The first step of a new event closes the previous one, so a saved block
+  // only ever holds complete events.
+  if (*evNr != lastEvent) {
+    if (fout) EndOfEvent();
+    lastEvent = *evNr;
+    nEvents++;
+    watchdog->BeginEvent(lastEvent);
+  }
+  if (watchdog->IsActive() && !watchdog->Check(aStep)) return;
 
-  if (currentEv != eventNr) {
-    currentEv=eventNr;
+  const G4Track* theTrack = aStep->GetTrack();
+  if (theTrack->GetDefinition() != opticalPhoton) {
+    ProcessStep(aStep);
+    return;
   }
 
-  const G4String currentPhysicalName = aStep->GetPreStepPoint()->GetPhysicalVolume()->GetName();
+  // Optical photons are almost every step; only an absorption inside a
+  // SiPM is of interest, everything else leaves here without touching
+  // the output variables.
+  nOpticalSteps++;
+  if (theTrack->GetCurrentStepNumber() == 1) nOpticalPhotons++;
+
+  const G4LogicalVolume* preLogical = aStep->GetPreStepPoint()->GetPhysicalVolume()->GetLogicalVolume();
+  if (preLogical != lSiPM) {
+    // BGO light of a vetoed event is not needed any more
+    if (preLogical == lBGO && eventAction->IsVetoed()) aStep->GetTrack()->SetTrackStatus(fStopAndKill);
+    nFastPath++;
+    return;
+  }
+  const G4VProcess* process = aStep->GetPostStepPoint()->GetProcessDefinedStep();
+  if (!process || process->GetProcessSubType() != fOpAbsorption) {
+    nFastPath++;
+    return;
+  }
+
+  RecordPhoton(aStep);
+}
+
+void SteppingAction::RecordPhoton(const G4Step* aStep)
+{
   G4StepPoint* thePrePoint = aStep->GetPreStepPoint();
   G4StepPoint* thePostPoint = aStep->GetPostStepPoint();
-  G4TouchableHandle theTouchable = thePrePoint->GetTouchableHandle();
+  const G4TouchableHandle& theTouchable = thePrePoint->GetTouchableHandle();
+
+  G4double time = thePostPoint->GetGlobalTime();
+  G4bool inBGO = thePrePoint->GetPhysicalVolume() == physiBGOSiPM;
+  G4int copy = inBGO ? 100 + theTouchable->GetCopyNumber(1) : theTouchable->GetCopyNumber();  //CopyNo kryształu BGOW + 100
+  G4int module = theTouchable->GetCopyNumber(inBGO ? 2 : 1);
+
+  // With the coated coupling the grease is not a volume: its absorption is
+  // applied along the path the photon had in it, n sin(theta) being the
+  // same in the grease and in the SiPM.
+  if (couplingThickness > 0. && !inBGO) {
+    G4double energy = aStep->GetTrack()->GetKineticEnergy();
+    G4ThreeVector direction = theTouchable->GetHistory()->GetTopTransform().TransformAxis(thePrePoint->GetMomentumDirection());
+    G4double sinRatio = sipmRindex->Value(energy)/greaseRindex->Value(energy);
+    G4double sin2Grease = sinRatio*sinRatio*(1. - direction.z()*direction.z());
+    G4double cosGrease = std::sqrt(std::max(1. - sin2Grease, 1.e-6));
+    if (G4UniformRand() > std::exp(-couplingThickness/(greaseAbsLength->Value(energy)*cosGrease))) {
+      nCouplingAbsorbed++;
+      return;
+    }
+  }
+
+  const G4Track* theTrack = aStep->GetTrack();
+  G4ThreeVector position = ModulePosition(theTouchable, inBGO ? 2 : 1, thePostPoint->GetPosition());
+  PhotonHit hit = {{position.x(), position.y(), position.z()}, time, aStep->GetTotalEnergyDeposit(),
+                   theTrack->GetVertexKineticEnergy(), theTrack->GetWeight(), copy, module, inBGO};
+  // A sub-event worker sends the hit back to the event instead
+  if (subEventPool && subEventPool->IsWorker()) {
+    subEventPool->Collect(hit);
+  } else {
+    StoreHit(hit);
+  }
+}
+
+void SteppingAction::StoreHit(const PhotonHit& hit)
+{
+  if (hit.inBGO) {
+    eventAction->AddBGOPhoton(hit.copy - 100, hit.time);
+  } else {
+    eventAction->AddSiPMPhoton(hit.copy, hit.time);
+  }
+
+  if (!writeStepTree) return;
+
+  InitVar();
+  eventNr = *evNr;
+  pType = 10;
+  pName = 20;
+  postPosX = hit.position[0];
+  postPosY = hit.position[1];
+  postPosZ = hit.position[2];
+  Det = hit.inBGO ? 23 : 22;
+  Edep = hit.edep;
+  KE = hit.vertexEnergy;
+  CopyNo = hit.module*DetectorConstruction::kModuleStride + hit.copy;
+  Gtime = hit.time;
+  weight = hit.weight;
+  FillRow();
+}
+
+OpticalCounts SteppingAction::GetOpticalCounts() const
+{
+  return {nSteps, nOpticalSteps, nFastPath, nOpticalPhotons, nCouplingAbsorbed};
+}
+
+void SteppingAction::AddOpticalCounts(const OpticalCounts& counts)
+{
+  nSteps += counts.steps;
+  nOpticalSteps += counts.opticalSteps;
+  nFastPath += counts.fastPath;
+  nOpticalPhotons += counts.photons;
+  nCouplingAbsorbed += counts.couplingAbsorbed;
+}
+
+void SteppingAction::ProcessStep(const G4Step* aStep)
+{
+  G4StepPoint* thePrePoint = aStep->GetPreStepPoint();
+  G4StepPoint* thePostPoint = aStep->GetPostStepPoint();
+  const G4LogicalVolume* preLogical = thePrePoint->GetPhysicalVolume()->GetLogicalVolume();
+  const G4Track* theTrack = aStep->GetTrack();
+  const G4VProcess* process = thePostPoint->GetProcessDefinedStep();
 
-  const G4String processName = aStep->GetPostStepPoint()->GetProcessDefinedStep()->GetProcessName();
-  const G4String particleName = aStep->GetTrack()->GetDefinition()->GetParticleName();
   G4double EdepStep = aStep->GetTotalEnergyDeposit();
+  G4double trackWeight = theTrack->GetWeight();
+
+  G4int slot = -1;
+  if (preLogical == lLaBr3) {
+    slot = EventAction::kSlotLaBr3;
+  } else if (preLogical == lBGO) {
+    slot = EventAction::kSlotBGO + thePrePoint->GetTouchableHandle()->GetCopyNumber(1);
+  } else if (preLogical == lReflector || preLogical == lReflectorFace || preLogical == lTeflon) {
+    slot = EventAction::kSlotReflector;
+  } else if (preLogical == lHousing) {
+    slot = EventAction::kSlotHousing;
+  }
+  if (slot >= 0 && EdepStep > 0.) {
+    // Birks quenching with the constant set on the volume's material
+    G4double visible = emSaturation->VisibleEnergyDepositionAtAStep(aStep);
+    eventAction->AddEdep(slot, EdepStep, visible, trackWeight);
+    if (slot == EventAction::kSlotLaBr3) {
+      G4ThreeVector midPoint = 0.5*(thePrePoint->GetPosition() + thePostPoint->GetPosition());
+      eventAction->AddLaBr3Position(ModulePosition(thePrePoint->GetTouchableHandle(), 1, midPoint), EdepStep);
+    }
+
+    // Photons created in this step, also when they are not stacked
+    // (/LaBr/phys/yieldOnly)
+    G4int nCreated = 0;
+    if (scintillation) nCreated += scintillation->GetNumPhotons();
+    if (cerenkov && theTrack->GetDefinition()->GetPDGCharge() != 0.) nCreated += cerenkov->GetNumPhotons();
+    eventAction->AddYield(slot, nCreated);
+  }
 
-  G4ThreeVector momentumVec = aStep->GetTrack()->GetMomentum();
-
-  G4bool fillTree =0;
-  if (currentPhysicalName == "Physi_LaBr3" && particleName != "opticalphoton") {
-    if (particleName == "gamma") {pType = 0;}
-    if (particleName == "e-") {pType = 1;}
-    if (particleName == "e+") {pType = 2;}
-
-    if (processName == "compt") {pName = 0;}
-    if (processName == "phot") {pName = 1;}
-    if (processName == "conv") {pName = 2;}
-    if (processName == "eIoni") {pName = 3;}
-    if (processName == "hIoni") {pName = 4;}
-    if (processName == "msc") {pName = 5;}
-    if (processName == "Scintillation") {pName = 6;}
-    if (processName == "Cerenkov") {pName = 7;}
-    if (processName == "eBrem") {pName = 8;}
-    if (processName == "Rayl") {pName = 9;}
-    if (processName == "Transportation") {pName = 10;}
-
-    postPosX = thePostPoint->GetPosition().getX();
-    postPosY = thePostPoint->GetPosition().getY();
-    postPosZ = thePostPoint->GetPosition().getZ();
-    Det = 11;
-    Edep = EdepStep;
-    KE = aStep->GetTrack()->GetVertexKineticEnergy();
-    CopyNo = theTouchable->GetCopyNumber();
-    Gtime = thePostPoint->GetGlobalTime();
-    momentumX = momentumVec.getX();
-    momentumY = momentumVec.getY();
-    momentumZ = momentumVec.getZ();
-    fillTree=1;
-  } else if (currentPhysicalName == "Physi_SiPM" && processName == "OpAbsorption") {
-    pType = 10;
-    pName = 20;
-    postPosX = thePostPoint->GetPosition().getX();
-    postPosY = thePostPoint->GetPosition().getY();
-    postPosZ = thePostPoint->GetPosition().getZ();
-    Det = 22;
-    Edep = EdepStep;
-    KE = aStep->GetTrack()->GetVertexKineticEnergy();
-    CopyNo =  theTouchable->GetCopyNumber();
-    Gtime = thePostPoint->GetGlobalTime();
-    fillTree=1;
-  } else if(currentPhysicalName == "BGO_SiPM" && processName == "OpAbsorption") {
-    pType = 10;
-    pName = 20;
-    postPosX = thePostPoint->GetPosition().getX();
-    postPosY = thePostPoint->GetPosition().getY();
-    postPosZ = thePostPoint->GetPosition().getZ();
-    Det = 23;
-    Edep = EdepStep;
-    KE = aStep->GetTrack()->GetVertexKineticEnergy();
-    CopyNo =100 + theTouchable->GetCopyNumber(1);  //CopyNo kryształu BGOW + 100
-    Gtime = thePostPoint->GetGlobalTime();
-    fillTree=1;
-  }else
-    fillTree=0;
-
-  if (fillTree) {
-    tout->Fill();
-  }
-  counter++;
+  if (slot == EventAction::kSlotLaBr3) {
+    if (writeStepTree && writeEdepSteps) {
+      InitVar();
+      eventNr = *evNr;
+
+      const G4String& particleName = theTrack->GetDefinition()->GetParticleName();
+      if (particleName == "gamma") {pType = 0;}
+      if (particleName == "e-") {pType = 1;}
+      if (particleName == "e+") {pType = 2;}
+
+      const G4String& processName = process->GetProcessName();
+      if (processName == "compt") {pName = 0;}
+      if (processName == "phot") {pName = 1;}
+      if (processName == "conv") {pName = 2;}
+      if (processName == "eIoni") {pName = 3;}
+      if (processName == "hIoni") {pName = 4;}
+      if (processName == "msc") {pName = 5;}
+      if (processName == "Scintillation") {pName = 6;}
+      if (processName == "Cerenkov") {pName = 7;}
+      if (processName == "eBrem") {pName = 8;}
+      if (processName == "Rayl") {pName = 9;}
+      if (processName == "Transportation") {pName = 10;}
+
+      const G4TouchableHandle& theTouchable = thePrePoint->GetTouchableHandle();
+      G4ThreeVector momentumVec = ModuleDirection(theTouchable, 1, theTrack->GetMomentum());
+      G4ThreeVector postPos = ModulePosition(theTouchable, 1, thePostPoint->GetPosition());
+      postPosX = postPos.getX();
+      postPosY = postPos.getY();
+      postPosZ = postPos.getZ();
+      Det = 11;
+      Edep = EdepStep;
+      KE = theTrack->GetVertexKineticEnergy();
+      CopyNo = theTouchable->GetCopyNumber(1)*DetectorConstruction::kModuleStride + theTouchable->GetCopyNumber();
+      Gtime = thePostPoint->GetGlobalTime();
+      momentumX = momentumVec.getX();
+      momentumY = momentumVec.getY();
+      momentumZ = momentumVec.getZ();
+      weight = trackWeight;
+      FillRow();
+    }
+  }
+
+  if (process && process->GetProcessSubType() == fRadioactiveDecay) {
+    G4double q = 0.;
+    for (const G4Track* secondary : *aStep->GetSecondaryInCurrentStep()) {
+      q += secondary->GetKineticEnergy();
+    }
+    eventAction->AddDecay(q, thePostPoint->GetGlobalTime(), trackWeight);
+  }
+}
+
+void SteppingAction::FillRow()
+{
+  if (!fout) {
+    InitOutput();
+  }
+  tout->Fill();
+  nRows++;
+}
+
+void SteppingAction::PrintStatistics() const
+{
+  if (nSteps == 0) return;
+
+  G4cout << "SteppingAction: " << nSteps << " steps, " << nOpticalSteps << " optical ("
+         << 100.*nOpticalSteps/nSteps << " %), fast path " << nFastPath << " ("
+         << 100.*nFastPath/nSteps << " % of all steps), rows written " << nRows << G4endl;
+  if (nOpticalPhotons > 0) {
+    G4cout << "SteppingAction: " << nOpticalPhotons << " optical photons, "
+           << G4double(nOpticalSteps)/nOpticalPhotons << " steps per photon" << G4endl;
+  }
+  if (couplingThickness > 0.) {
+    G4cout << "SteppingAction: " << nCouplingAbsorbed << " photons absorbed in the coated grease layer" << G4endl;
+  }
 }
 
 void SteppingAction::InitVar()
@@ -163,8 +492,8 @@ void SteppingAction::InitVar()
   postPosY = -999;
   postPosZ = -999;
   Gtime = -9;
-  counter = 0;
   momentumX = -9;
   momentumY = -9;
   momentumZ = -9;
+  weight = 1;
 }
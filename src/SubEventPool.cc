@@ -0,0 +1,246 @@
+#include "SubEventPool.hh"
+#include "SteppingAction.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4TrackingManager.hh"
+#include "G4DynamicParticle.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4EventManager.hh"
+#include "G4TrackVector.hh"
+#include "G4Track.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <poll.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+  // Each batch writes its counts, then the number of hits and the hits
+  const std::size_t kHeaderSize = sizeof(OpticalCounts) + sizeof(WatchdogCounts) + sizeof(std::uint64_t);
+
+  G4bool WriteAll(int fd, const void* data, std::size_t size)
+  {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+      ssize_t n = write(fd, p, size);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      p += n;
+      size -= n;
+    }
+    return true;
+  }
+}
+
+SubEventPool::SubEventPool(SteppingAction* stAction)
+  : steppingAction(stAction), workers(0), batchSize(10000), worker(false),
+    nEvents(0), nBatches(0), nPhotons(0), nFailed(0), nAborted(0), wallTime(0.)
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/subevent/", "Sub-event parallel tracking of LaBr3 optical photons");
+  messenger->DeclareProperty("workers", workers, "Worker processes per event (0 = track the photons on the stack)")
+    .SetRange("workers>=0");
+  messenger->DeclareProperty("batchSize", batchSize, "Optical photons per sub-event (sets the random sequences)")
+    .SetRange("batchSize>0");
+}
+
+SubEventPool::~SubEventPool()
+{
+  delete messenger;
+  if (nEvents == 0) return;
+
+  G4cout << "Sub-events: " << nEvents << " events, " << nPhotons << " LaBr3 photons in " << nBatches
+         << " batches of " << batchSize << " (" << nFailed << " failed), " << nAborted << " events aborted, "
+         << workers << " workers, "
+         << wallTime << " s" << G4endl;
+}
+
+void SubEventPool::AddPhoton(const G4Track* track)
+{
+  const G4ThreeVector& pos = track->GetPosition();
+  const G4ThreeVector& dir = track->GetMomentumDirection();
+  const G4ThreeVector& pol = track->GetPolarization();
+  photons.push_back({{pos.x(), pos.y(), pos.z()}, {dir.x(), dir.y(), dir.z()}, {pol.x(), pol.y(), pol.z()},
+                     track->GetKineticEnergy(), track->GetGlobalTime(), track->GetWeight(),
+                     track->GetTrackID(), track->GetParentID()});
+}
+
+// Called at the end of the event, before its outputs are filled
+G4bool SubEventPool::Process()
+{
+  if (photons.empty()) return true;
+  auto start = std::chrono::steady_clock::now();
+
+  std::size_t nBatch = (photons.size() + batchSize - 1)/batchSize;
+  long eventSeed = 1 + long(G4UniformRand()*2147483646.);
+  std::vector<std::vector<char>> output(nBatch);
+  std::vector<G4bool> done(nBatch, false);
+
+  struct Running {
+    pid_t pid;
+    int fd;
+    std::size_t batch;
+  };
+  std::vector<Running> running;
+  std::size_t next = 0;
+
+  // Buffered output would otherwise be printed again by every worker
+  G4cout << std::flush;
+  std::fflush(nullptr);
+
+  while (next < nBatch || !running.empty()) {
+    while (next < nBatch && running.size() < std::size_t(workers)) {
+      int fds[2];
+      if (pipe(fds) != 0) {
+        next++;
+        continue;
+      }
+      pid_t pid = fork();
+      if (pid == 0) {
+        close(fds[0]);
+        RunBatch(next, eventSeed, fds[1]);
+      }
+      close(fds[1]);
+      if (pid < 0) {
+        close(fds[0]);
+      } else {
+        running.push_back({pid, fds[0], next});
+      }
+      next++;
+    }
+    if (running.empty()) continue;
+
+    // All pipes are drained, so no worker blocks on a full one
+    std::vector<pollfd> fds;
+    for (const Running& r : running) fds.push_back({r.fd, POLLIN, 0});
+    if (poll(fds.data(), fds.size(), -1) < 0) continue;
+
+    for (std::size_t i=running.size(); i-- > 0;) {
+      if (!fds[i].revents) continue;
+      char buffer[65536];
+      ssize_t n = read(running[i].fd, buffer, sizeof(buffer));
+      if (n > 0) {
+        output[running[i].batch].insert(output[running[i].batch].end(), buffer, buffer + n);
+        continue;
+      }
+      if (n < 0 && errno == EINTR) continue;
+
+      close(running[i].fd);
+      int status = 0;
+      waitpid(running[i].pid, &status, 0);
+      done[running[i].batch] = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+      running.erase(running.begin() + i);
+    }
+  }
+
+  // The counts first, so that an aborted event stores no hits
+  Watchdog* watchdog = steppingAction->GetWatchdog();
+  for (std::size_t batch=0; batch<nBatch; batch++) {
+    OpticalCounts counts;
+    WatchdogCounts watchdogCounts;
+    if (done[batch] && ReadCounts(output[batch], counts, watchdogCounts)) {
+      steppingAction->AddOpticalCounts(counts);
+      watchdog->AddEventCounts(watchdogCounts);
+      continue;
+    }
+    done[batch] = false;
+    nFailed++;
+    G4ExceptionDescription ed;
+    ed << "Sub-event " << batch << " of " << nBatch << " failed; its "
+       << std::min<std::size_t>(batchSize, photons.size() - batch*batchSize) << " photons are lost";
+    G4Exception("SubEventPool::Process()", "SubEvent001", JustWarning, ed);
+  }
+  G4bool aborted = watchdog->IsEventAborted();
+  if (aborted) {
+    nAborted++;
+  } else {
+    for (std::size_t batch=0; batch<nBatch; batch++) {
+      if (done[batch]) StoreHits(output[batch]);
+    }
+  }
+
+  nEvents++;
+  nBatches += nBatch;
+  nPhotons += photons.size();
+  photons.clear();
+  wallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return !aborted;
+}
+
+// Worker process: tracks one batch, writes the step counts and the SiPM
+// hits to the pipe and exits without running any destructor, so the
+// output files shared with the parent are left alone.
+void SubEventPool::RunBatch(std::size_t batch, long eventSeed, int fd)
+{
+  worker = true;
+  hits.clear();
+  Watchdog* watchdog = steppingAction->GetWatchdog();
+  watchdog->SetWorker();
+  WatchdogCounts watchdogBefore = watchdog->GetEventCounts();
+  long seeds[3] = {eventSeed, long(batch) + 1, 0};
+  G4Random::setTheSeeds(seeds);
+
+  G4TrackingManager* trackingManager = G4EventManager::GetEventManager()->GetTrackingManager();
+  trackingManager->SetStoreTrajectory(0);
+  const G4ParticleDefinition* opticalPhoton = G4OpticalPhoton::Definition();
+  OpticalCounts before = steppingAction->GetOpticalCounts();
+
+  std::size_t last = std::min<std::size_t>(photons.size(), (batch + 1)*batchSize);
+  for (std::size_t i=batch*batchSize; i<last; i++) {
+    const StackedPhoton& p = photons[i];
+    G4ThreeVector direction(p.direction[0], p.direction[1], p.direction[2]);
+    G4Track* track = new G4Track(new G4DynamicParticle(opticalPhoton, direction, p.energy), p.time,
+                                 G4ThreeVector(p.position[0], p.position[1], p.position[2]));
+    track->SetPolarization(G4ThreeVector(p.polarization[0], p.polarization[1], p.polarization[2]));
+    track->SetTrackID(p.trackID);
+    track->SetParentID(p.parentID);
+    track->SetWeight(p.weight);
+    trackingManager->ProcessOneTrack(track);
+
+    // Optical photons make no secondaries worth following (no WLS here)
+    G4TrackVector* secondaries = trackingManager->GimmeSecondaries();
+    for (G4Track* secondary : *secondaries) delete secondary;
+    secondaries->clear();
+    delete track;
+    if (watchdog->IsEventAborted()) break;
+  }
+
+  OpticalCounts after = steppingAction->GetOpticalCounts();
+  OpticalCounts counts = {after.steps - before.steps, after.opticalSteps - before.opticalSteps,
+                          after.fastPath - before.fastPath, after.photons - before.photons,
+                          after.couplingAbsorbed - before.couplingAbsorbed};
+  WatchdogCounts watchdogAfter = watchdog->GetEventCounts();
+  WatchdogCounts watchdogCounts = {watchdogAfter.steps - watchdogBefore.steps,
+                                   watchdogAfter.killedTracks - watchdogBefore.killedTracks, watchdogAfter.abortReason};
+  std::uint64_t nHits = hits.size();
+  G4bool ok = WriteAll(fd, &counts, sizeof(counts)) && WriteAll(fd, &watchdogCounts, sizeof(watchdogCounts))
+    && WriteAll(fd, &nHits, sizeof(nHits)) && WriteAll(fd, hits.data(), nHits*sizeof(PhotonHit));
+  close(fd);
+  _exit(ok ? 0 : 1);
+}
+
+G4bool SubEventPool::ReadCounts(const std::vector<char>& data, OpticalCounts& counts, WatchdogCounts& watchdogCounts) const
+{
+  if (data.size() < kHeaderSize) return false;
+
+  std::uint64_t nHits;
+  std::memcpy(&counts, data.data(), sizeof(counts));
+  std::memcpy(&watchdogCounts, data.data() + sizeof(counts), sizeof(watchdogCounts));
+  std::memcpy(&nHits, data.data() + sizeof(counts) + sizeof(watchdogCounts), sizeof(nHits));
+  return data.size() == kHeaderSize + nHits*sizeof(PhotonHit);
+}
+
+void SubEventPool::StoreHits(const std::vector<char>& data)
+{
+  for (std::size_t offset=kHeaderSize; offset<data.size(); offset+=sizeof(PhotonHit)) {
+    PhotonHit hit;
+    std::memcpy(&hit, data.data() + offset, sizeof(PhotonHit));
+    steppingAction->StoreHit(hit);
+  }
+}
@@ -0,0 +1,62 @@
+#include "TrackingAction.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4TrackingManager.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4EventManager.hh"
+#include "G4Event.hh"
+#include "G4Track.hh"
+
+#include <cstdint>
+
+TrackingAction::TrackingAction()
+  : G4UserTrackingAction(), opticalPhoton(nullptr), photonFraction(1.), maxPhotons(0), storeMode(0),
+    currentEvent(-1), eventPhotons(0)
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/vis/", "Trajectory filter for optical runs");
+  messenger->DeclareProperty("photonFraction", photonFraction, "Fraction of optical photons that store a trajectory")
+    .SetRange("photonFraction>=0 && photonFraction<=1");
+  messenger->DeclareProperty("maxPhotons", maxPhotons, "Optical photon trajectories stored per event (0 = no limit)")
+    .SetRange("maxPhotons>=0");
+}
+
+TrackingAction::~TrackingAction()
+{
+  delete messenger;
+}
+
+void TrackingAction::PreUserTrackingAction(const G4Track* aTrack)
+{
+  storeMode = fpTrackingManager->GetStoreTrajectory();
+  if (storeMode == 0 || !IsActive()) return;
+
+  if (!opticalPhoton) opticalPhoton = G4OpticalPhoton::Definition();
+  if (aTrack->GetDefinition() != opticalPhoton) return;
+
+  // Plain trajectories, one point per step
+  fpTrackingManager->SetStoreTrajectory(KeepPhoton(aTrack) ? 1 : 0);
+}
+
+void TrackingAction::PostUserTrackingAction(const G4Track*)
+{
+  fpTrackingManager->SetStoreTrajectory(storeMode);
+}
+
+G4bool TrackingAction::KeepPhoton(const G4Track* aTrack)
+{
+  G4int eventID = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID();
+  if (eventID != currentEvent) {
+    currentEvent = eventID;
+    eventPhotons = 0;
+  }
+  if (maxPhotons > 0 && eventPhotons >= maxPhotons) return false;
+
+  std::uint32_t hash = std::uint32_t(aTrack->GetTrackID())*2654435761u ^ std::uint32_t(eventID)*2246822519u;
+  hash ^= hash >> 15;
+  hash *= 2654435761u;
+  hash ^= hash >> 13;
+  if (hash >= photonFraction*4294967296.) return false;
+
+  eventPhotons++;
+  return true;
+}
@@ -0,0 +1,121 @@
+#include "Watchdog.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4EventManager.hh"
+#include "G4TrackStatus.hh"
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4ios.hh"
+
+Watchdog::Watchdog(G4String nameAdd)
+  : maxTrackSteps(0), maxEventSteps(0), maxEventTime(0.), logName("Watchdog_" + nameAdd + ".txt"),
+    currentEvent(-1), eventSteps(0), eventKilledTracks(0), abortReason(kNotAborted), worker(false),
+    nEvents(0), nKilledTracks(0), nTrackEvents(0), nAbortedEvents(0)
+{
+  messenger = new G4GenericMessenger(this, "/LaBr/watchdog/", "Per-track and per-event tracking limits");
+  messenger->DeclareProperty("maxTrackSteps", maxTrackSteps, "Steps after which a track is killed (0 = no limit)")
+    .SetRange("maxTrackSteps>=0");
+  messenger->DeclareProperty("maxEventSteps", maxEventSteps, "Steps after which an event is aborted (0 = no limit)");
+  messenger->DeclarePropertyWithUnit("maxEventTime", "s", maxEventTime, "Wall time after which an event is aborted (0 = no limit)");
+}
+
+Watchdog::~Watchdog()
+{
+  EndEvent();
+  PrintStatistics();
+  delete messenger;
+}
+
+std::ofstream& Watchdog::Log()
+{
+  if (!log.is_open()) log.open(logName);
+  return log;
+}
+
+void Watchdog::BeginEvent(G4int eventNr)
+{
+  EndEvent();
+  currentEvent = eventNr;
+  eventSteps = 0;
+  eventKilledTracks = 0;
+  abortReason = kNotAborted;
+  if (maxEventTime > 0.) eventStart = std::chrono::steady_clock::now();
+  if (IsActive()) nEvents++;
+}
+
+void Watchdog::EndEvent()
+{
+  if (eventKilledTracks == 0) return;
+  Log() << currentEvent << " trackSteps " << eventKilledTracks << std::endl;
+  nTrackEvents++;
+  eventKilledTracks = 0;
+}
+
+void Watchdog::AbortEvent(G4int reason, G4Track* track)
+{
+  abortReason = reason;
+  // A worker only stops its batch, the event aborts when the counts come back
+  if (worker) {
+    track->SetTrackStatus(fKillTrackAndSecondaries);
+    return;
+  }
+  Log() << currentEvent << " " << (reason == kWallTime ? "wallTime" : "eventSteps") << " " << eventSteps << std::endl;
+  nAbortedEvents++;
+  G4EventManager::GetEventManager()->AbortCurrentEvent();
+}
+
+G4bool Watchdog::OverTime() const
+{
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - eventStart;
+  return elapsed.count()*s > maxEventTime;
+}
+
+G4bool Watchdog::Check(const G4Step* aStep)
+{
+  if (IsEventAborted()) return false;
+  eventSteps++;
+
+  G4Track* track = aStep->GetTrack();
+  if (maxTrackSteps > 0 && track->GetCurrentStepNumber() > maxTrackSteps) {
+    track->SetTrackStatus(fStopAndKill);
+    eventKilledTracks++;
+    nKilledTracks++;
+    return false;
+  }
+  if (maxEventSteps > 0 && eventSteps > maxEventSteps) {
+    AbortEvent(kEventSteps, track);
+    return false;
+  }
+  // The clock is read only every few thousand steps
+  if (maxEventTime > 0. && eventSteps % 4096 == 0 && OverTime()) {
+    AbortEvent(kWallTime, track);
+    return false;
+  }
+  return true;
+}
+
+// Called in batch order, so the reason of an aborted event is reproducible
+void Watchdog::AddEventCounts(const WatchdogCounts& counts)
+{
+  eventSteps += counts.steps;
+  eventKilledTracks += counts.killedTracks;
+  nKilledTracks += counts.killedTracks;
+  if (IsEventAborted()) return;
+
+  if (counts.abortReason == kEventSteps || (maxEventSteps > 0 && eventSteps > maxEventSteps)) {
+    AbortEvent(kEventSteps, nullptr);
+  } else if (counts.abortReason == kWallTime || (maxEventTime > 0. && OverTime())) {
+    AbortEvent(kWallTime, nullptr);
+  }
+}
+
+void Watchdog::PrintStatistics() const
+{
+  if (nEvents == 0) return;
+
+  G4cout << "Watchdog: " << nEvents << " events, " << nKilledTracks << " tracks killed in " << nTrackEvents
+         << " events, " << nAbortedEvents << " events aborted";
+  if (nTrackEvents + nAbortedEvents > 0) G4cout << " (listed in " << logName << ")";
+  G4cout << G4endl;
+}